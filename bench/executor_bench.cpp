@@ -0,0 +1,264 @@
+// Microbenchmarks of Static_thread_pool executors
+//
+// Usage: executor_bench [--ops N] [--threads 1,2,4] [--payloads 0,32,128]
+//                       [--filter name] [--output file.json] [--counters on|off]
+// JSON goes to --output (or stdout), a summary goes to stderr
+#include <atomic>
+#include <array>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstring>
+#include <cstdlib>
+#include "execution.hpp"
+#include "property.hpp"
+#include "bsio.hpp"
+#include "harness.hpp"
+
+using namespace bsio::execution;
+using bench::Clock;
+
+namespace {
+
+// Captured by every task, 0 and 32 bytes fit in the inline storage of a node, 128 does not
+template <size_t Size>
+struct Payload {
+    std::array<std::byte, Size> _bytes {};
+
+    void touch() const {
+        if constexpr (Size > 0) {
+            volatile std::byte sink = _bytes[Size - 1];
+            (void)sink;
+        }
+    }
+};
+
+// Shared by fire-and-forget tasks of a run
+struct Completion {
+    explicit Completion(uint64_t ops): _remaining(ops) {}
+
+    void done() {
+        if(_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) _remaining.notify_all();
+    }
+
+    void wait() {
+        for(auto remaining = _remaining.load(std::memory_order_acquire); remaining;
+                remaining = _remaining.load(std::memory_order_acquire)) {
+            _remaining.wait(remaining, std::memory_order_acquire);
+        }
+    }
+
+    std::atomic<uint64_t> _remaining;
+    bsio::Task_recorder _recorder;
+};
+
+// A task records its submit-to-start latency
+template <size_t Size>
+auto make_task(Completion &completion, const Payload<Size> &payload) {
+    return [&completion, submitted = Clock::now(), payload] {
+        completion._recorder.record_queue_wait(Clock::now() - submitted);
+        payload.touch();
+        completion.done();
+    };
+}
+
+// `bind(ex)` returns a submitter, i.e. submitter(task)
+// Submitted from the calling (non-pool) thread
+template <size_t Size>
+bench::Result run_outside(const char *name, size_t threads, uint64_t ops, auto &&bind) {
+    bsio::Static_thread_pool pool(threads);
+    auto submit = bind(pool.executor());
+    Completion completion {ops};
+    Payload<Size> payload;
+    auto elapsed = bench::time_run([&] {
+        for(uint64_t i = 0; i < ops; ++i) submit(make_task(completion, payload));
+        completion.wait();
+    });
+    pool.wait();
+    return {name, threads, Size, ops, elapsed, completion._recorder.queue_wait(), "submit_to_start"};
+}
+
+// Submitted by one seed task per worker
+template <size_t Size>
+bench::Result run_inside(const char *name, size_t threads, uint64_t ops, auto &&bind) {
+    bsio::Static_thread_pool pool(threads);
+    auto ex = pool.executor();
+    Completion completion {ops};
+    Payload<Size> payload;
+    auto elapsed = bench::time_run([&] {
+        auto never = bsio::require(ex, blocking.never);
+        for(size_t seed = 0; seed < threads; ++seed) {
+            uint64_t count = ops / threads + (seed < ops % threads);
+            never.execute([&, submit = bind(ex), count]() mutable {
+                for(uint64_t i = 0; i < count; ++i) submit(make_task(completion, payload));
+            });
+        }
+        completion.wait();
+    });
+    pool.wait();
+    return {name, threads, Size, ops, elapsed, completion._recorder.queue_wait(), "submit_to_start"};
+}
+
+// The caller waits for each op
+template <size_t Size>
+bench::Result run_round_trip(const char *name, size_t threads, uint64_t ops, auto &&bind) {
+    bsio::Static_thread_pool pool(threads);
+    auto round_trip = bind(pool.executor());
+    Payload<Size> payload;
+    bsio::Latency_histogram latency;
+    auto elapsed = bench::time_run([&] {
+        for(uint64_t i = 0; i < ops; ++i) {
+            auto start = Clock::now();
+            round_trip([payload] { payload.touch(); });
+            latency.record(Clock::now() - start);
+        }
+    });
+    pool.wait();
+    return {name, threads, Size, ops, elapsed, std::move(latency), "round_trip"};
+}
+
+template <size_t Size>
+void run_cases(const bench::Options &options, size_t threads, bench::Perf_counters *counters,
+               std::vector<bench::Result> &results)
+{
+    auto selected = [&](const char *name) {
+        return options.filter.empty() || std::string(name).find(options.filter) != std::string::npos;
+    };
+    // Counters cover the whole case, so the pool is created within `run`
+    auto add = [&](auto run) {
+        auto result = bench::count_run(counters, run);
+        bench::write_summary(stderr, result);
+        results.push_back(std::move(result));
+    };
+    auto ops = options.ops;
+    auto round_trip_ops = options.round_trip_ops;
+
+    if(selected("execute/outside")) {
+        add([&] { return run_outside<Size>("execute/outside", threads, ops, [](auto ex) {
+            return [never = bsio::require(ex, blocking.never)](auto task) mutable { never.execute(std::move(task)); };
+        }); });
+    }
+    if(selected("execute/inside")) {
+        add([&] { return run_inside<Size>("execute/inside", threads, ops, [](auto ex) {
+            return [never = bsio::require(ex, blocking.never)](auto task) mutable { never.execute(std::move(task)); };
+        }); });
+    }
+    if(selected("post/outside")) {
+        add([&] { return run_outside<Size>("post/outside", threads, ops, [](auto ex) {
+            return [ex](auto task) { bsio::post(ex, std::move(task)); };
+        }); });
+    }
+    if(selected("dispatch/outside")) {
+        add([&] { return run_outside<Size>("dispatch/outside", threads, ops, [](auto ex) {
+            return [ex](auto task) { bsio::dispatch(ex, std::move(task)); };
+        }); });
+    }
+    if(selected("defer/inside")) {
+        add([&] { return run_inside<Size>("defer/inside", threads, ops, [](auto ex) {
+            return [ex](auto task) { bsio::defer(ex, std::move(task)); };
+        }); });
+    }
+    if(selected("polymorphic/outside")) {
+        add([&] { return run_outside<Size>("polymorphic/outside", threads, ops, [](auto ex) {
+            // Erased once, as a generic caller would hold it
+            using Executor = Polymorphic_executor<Directionality::Oneway, Blocking::Never, Blocking::Possibly>;
+            Executor erased = bsio::require(ex, blocking.never);
+            return [erased](auto task) mutable { erased.execute(std::move(task)); };
+        }); });
+    }
+    if(selected("twoway/round_trip")) {
+        add([&] { return run_round_trip<Size>("twoway/round_trip", threads, round_trip_ops, [](auto ex) {
+            return [twoway = bsio::require(ex, directionality.twoway)](auto func) mutable {
+                twoway.twoway_execute(std::move(func)).get();
+            };
+        }); });
+    }
+    // Mostly run inline by the caller, not a handoff to a worker
+    if(selected("blocking_always/caller_runs")) {
+        add([&] { return run_round_trip<Size>("blocking_always/caller_runs", threads, round_trip_ops, [](auto ex) {
+            return [always = bsio::require(ex, blocking.always)](auto func) mutable {
+                always.execute(std::move(func));
+            };
+        }); });
+    }
+}
+
+std::vector<size_t> parse_list(const char *list) {
+    std::vector<size_t> values;
+    for(const char *p = list; *p;) {
+        char *end;
+        values.push_back(std::strtoull(p, &end, 10));
+        p = *end ? end + 1 : end;
+    }
+    return values;
+}
+
+void print_usage(const char *program) {
+    std::cerr << "usage: " << program << " [--ops N] [--threads N,...] [--payloads 0,32,128]"
+              << " [--filter NAME] [--output FILE] [--counters on|off]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bench::Options options;
+    std::vector<size_t> payloads {0, 32, 128};
+    for(int i = 1; i < argc; i += 2) {
+        std::string key = argv[i];
+        if(i + 1 == argc) {
+            std::cerr << "missing value of option: " << key << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(key == "--ops") options.ops = options.round_trip_ops = std::strtoull(argv[i + 1], nullptr, 10);
+        else if(key == "--threads") options.threads = parse_list(argv[i + 1]);
+        else if(key == "--payloads") payloads = parse_list(argv[i + 1]);
+        else if(key == "--filter") options.filter = argv[i + 1];
+        else if(key == "--output") options.output = argv[i + 1];
+        else if(key == "--counters") options.counters = std::string(argv[i + 1]) != "off";
+        else {
+            std::cerr << "unknown option: " << key << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(options.threads.empty()) {
+        options.threads = {1, 2, 4};
+        if(size_t hardware = std::thread::hardware_concurrency(); hardware > 4) {
+            options.threads.push_back(hardware);
+        }
+    }
+
+    // Opened once, a missing counter is reported as null
+    std::optional<bench::Perf_counters> perf_counters;
+    bench::Perf_counters *counters = nullptr;
+    if(options.counters) {
+        perf_counters.emplace();
+        if(perf_counters->available()) counters = &*perf_counters;
+        else std::cerr << "perf_event_open is not available, counters are disabled" << std::endl;
+    }
+
+    std::vector<bench::Result> results;
+    for(auto threads : options.threads) {
+        for(auto payload : payloads) {
+            switch(payload) {
+                case 0:   run_cases<0>(options, threads, counters, results); break;
+                case 32:  run_cases<32>(options, threads, counters, results); break;
+                case 128: run_cases<128>(options, threads, counters, results); break;
+                default:
+                    std::cerr << "unsupported payload: " << payload << " (0, 32, 128)" << std::endl;
+                    return 1;
+            }
+        }
+    }
+
+    if(options.output.empty()) {
+        bench::write_json(std::cout, results);
+    } else {
+        std::ofstream file {options.output};
+        bench::write_json(file, results);
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <ostream>
+#include <cstdio>
+#include <cstdint>
+#include "executors/Instrumented_executor.hpp"
+#include "perf_counters.hpp"
+
+// A tiny benchmark harness
+// Each case runs `ops` operations, reports ops/sec and latency percentiles,
+// results are written as a JSON array for regression tracking
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    size_t threads;
+    size_t payload;
+    uint64_t ops;
+    std::chrono::nanoseconds elapsed;
+    // What the latency means depends on the case, see `latency_kind`
+    bsio::Latency_histogram latency;
+    std::string latency_kind;
+    // Whole case, including construction and destruction of the pool
+    Perf_counters::Values counters {};
+
+    double ops_per_sec() const {
+        return elapsed.count() ? ops * 1e9 / elapsed.count() : 0;
+    }
+};
+
+struct Options {
+    uint64_t ops {200000};
+    // Round trips are slower, fewer of them
+    uint64_t round_trip_ops {20000};
+    std::vector<size_t> threads;
+    // Empty: all cases
+    std::string filter;
+    std::string output;
+    // perf_event_open counters, if available
+    bool counters {true};
+};
+
+// Time a whole run, `run` returns after all ops are done
+inline std::chrono::nanoseconds time_run(const std::function<void()> &run) {
+    auto start = Clock::now();
+    run();
+    return Clock::now() - start;
+}
+
+// `run` returns a Result, counters are attached to it
+inline Result count_run(Perf_counters *counters, const std::function<Result()> &run) {
+    if(!counters) return run();
+    counters->start();
+    auto result = run();
+    result.counters = counters->stop();
+    return result;
+}
+
+// {"cycles":1,"instructions":null,...,"user_only":false}, null if not available
+inline void write_counters_json(std::ostream &os, const Perf_counters::Values &values) {
+    os << '{';
+    for(size_t i = 0; i < Perf_counters::size; ++i) {
+        os << '"' << Perf_counters::names[i] << "\":";
+        if(auto &count = values._counts[i]) os << *count;
+        else os << "null";
+        os << ',';
+    }
+    os << "\"user_only\":" << (values._user_only ? "true" : "false") << '}';
+}
+
+inline void write_json(std::ostream &os, const std::vector<Result> &results) {
+    char line[512];
+    os << "{\"benchmarks\":[";
+    for(size_t i = 0; i < results.size(); ++i) {
+        auto &result = results[i];
+        auto &latency = result.latency;
+        std::snprintf(line, sizeof line,
+            "%s\n  {\"name\":\"%s\",\"threads\":%zu,\"payload\":%zu,\"ops\":%llu,"
+            "\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+            "\"latency\":{\"kind\":\"%s\",\"count\":%llu,\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld},"
+            "\"counters\":",
+            i ? "," : "",
+            result.name.c_str(), result.threads, result.payload,
+            static_cast<unsigned long long>(result.ops),
+            result.elapsed.count() / 1e9, result.ops_per_sec(),
+            result.latency_kind.c_str(),
+            static_cast<unsigned long long>(latency.count()),
+            static_cast<long long>(latency.percentile(0.5).count()),
+            static_cast<long long>(latency.percentile(0.99).count()),
+            static_cast<long long>(latency.percentile(0.999).count()),
+            static_cast<long long>(latency.max().count()));
+        os << line;
+        write_counters_json(os, result.counters);
+        os << '}';
+    }
+    os << "\n]}\n";
+}
+
+// One line per case for humans, on stderr
+inline void write_summary(std::FILE *file, const Result &result) {
+    std::fprintf(file, "%-28s threads=%-3zu payload=%-4zu %12.0f ops/s  %s p50=%lldns p99=%lldns p999=%lldns\n",
+        result.name.c_str(), result.threads, result.payload, result.ops_per_sec(),
+        result.latency_kind.c_str(),
+        static_cast<long long>(result.latency.percentile(0.5).count()),
+        static_cast<long long>(result.latency.percentile(0.99).count()),
+        static_cast<long long>(result.latency.percentile(0.999).count()));
+    // Per op, to compare cases of different sizes
+    auto &counts = result.counters._counts;
+    if(std::none_of(counts.begin(), counts.end(), [](auto &count) { return count.has_value(); })) return;
+    std::fprintf(file, "%28s", "");
+    for(size_t i = 0; i < Perf_counters::size; ++i) {
+        if(counts[i]) std::fprintf(file, " %s/op=%.3f", Perf_counters::names[i], double(*counts[i]) / result.ops);
+    }
+    std::fprintf(file, "\n");
+}
+
+} // namespace bench
@@ -0,0 +1,191 @@
+#pragma once
+#include <array>
+#include <optional>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// Hardware and software counters of the calling thread and all threads it creates later
+//
+// Counters are opened with `inherit`, so the workers of a pool constructed within
+// start()/stop() are counted as well, but only after they exit:
+// construct and destroy the pool between start() and stop()
+//
+// Fallback:
+// - Counters are user space only if the kernel refuses to count the kernel
+//   (perf_event_paranoid >= 2 without privileges)
+// - A counter that cannot be opened at all (no PMU in a VM, paranoid 3, not Linux) is reported as missing
+// - Multiplexed counters are scaled by time enabled / time running
+namespace bench {
+
+class Perf_counters {
+public:
+    enum Counter: size_t {
+        cycles,
+        instructions,
+        cache_misses,
+        context_switches,
+        cpu_migrations,
+        size
+    };
+
+    static constexpr std::array<const char*, size> names {
+        "cycles", "instructions", "cache_misses", "context_switches", "cpu_migrations"
+    };
+
+    struct Values {
+        // Empty if not available
+        std::array<std::optional<uint64_t>, size> _counts;
+        // Counted in user space only
+        bool _user_only {false};
+    };
+
+    Perf_counters();
+    ~Perf_counters();
+
+    Perf_counters(const Perf_counters &) = delete;
+    Perf_counters& operator=(const Perf_counters &) = delete;
+
+    // At least one counter is available
+    bool available() const noexcept;
+
+    // Enable all counters
+    void start() noexcept;
+
+    // Disable all counters and read them
+    Values stop() noexcept;
+
+private:
+    // Counts of exited threads are never reset by the kernel, so a run is a difference of two readings
+    struct Reading {
+        uint64_t _value;
+        uint64_t _enabled;
+        uint64_t _running;
+    };
+
+    std::array<Reading, size> read_all() noexcept;
+
+    std::array<int, size> _fds;
+    std::array<Reading, size> _start {};
+    bool _user_only {false};
+};
+
+
+#if defined(__linux__)
+
+namespace perf_detail {
+
+inline int open_counter(uint32_t type, uint64_t config, bool user_only) noexcept {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    // PERF_FORMAT_GROUP cannot be used with inherit, counters are read one by one
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+} // namespace perf_detail
+
+inline Perf_counters::Perf_counters() {
+    constexpr std::array<std::pair<uint32_t, uint64_t>, size> events {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+    }};
+    // Return: true if any counter is denied in this mode
+    auto open_all = [&](bool user_only) {
+        bool denied = false;
+        for(size_t i = 0; i < size; ++i) {
+            _fds[i] = perf_detail::open_counter(events[i].first, events[i].second, user_only);
+            if(_fds[i] < 0 && (errno == EACCES || errno == EPERM)) denied = true;
+        }
+        return denied;
+    };
+    // All counters share the same mode
+    if(open_all(false)) {
+        for(auto &fd : _fds) {
+            if(fd >= 0) ::close(fd);
+        }
+        _user_only = true;
+        open_all(true);
+    }
+}
+
+inline Perf_counters::~Perf_counters() {
+    for(auto fd : _fds) {
+        if(fd >= 0) ::close(fd);
+    }
+}
+
+inline bool Perf_counters::available() const noexcept {
+    for(auto fd : _fds) {
+        if(fd >= 0) return true;
+    }
+    return false;
+}
+
+inline auto Perf_counters::read_all() noexcept -> std::array<Reading, size> {
+    std::array<Reading, size> readings {};
+    for(size_t i = 0; i < size; ++i) {
+        if(_fds[i] < 0) continue;
+        uint64_t data[3];
+        if(::read(_fds[i], data, sizeof data) != sizeof data) continue;
+        readings[i] = {data[0], data[1], data[2]};
+    }
+    return readings;
+}
+
+inline void Perf_counters::start() noexcept {
+    _start = read_all();
+    for(auto fd : _fds) {
+        if(fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+inline auto Perf_counters::stop() noexcept -> Values {
+    for(auto fd : _fds) {
+        if(fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    auto stop = read_all();
+    Values values;
+    values._user_only = _user_only;
+    for(size_t i = 0; i < size; ++i) {
+        if(_fds[i] < 0) continue;
+        uint64_t value = stop[i]._value - _start[i]._value;
+        uint64_t enabled = stop[i]._enabled - _start[i]._enabled;
+        uint64_t running = stop[i]._running - _start[i]._running;
+        // Never scheduled on the PMU, e.g. out of hardware counters
+        if(!running) continue;
+        values._counts[i] = running == enabled ? value
+            : static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+    }
+    return values;
+}
+
+#else
+
+inline Perf_counters::Perf_counters() { _fds.fill(-1); }
+inline Perf_counters::~Perf_counters() = default;
+inline bool Perf_counters::available() const noexcept { return false; }
+inline void Perf_counters::start() noexcept {}
+inline auto Perf_counters::read_all() noexcept -> std::array<Reading, size> { return {}; }
+inline auto Perf_counters::stop() noexcept -> Values { return {}; }
+
+#endif
+
+} // namespace bench
@@ -0,0 +1,90 @@
+#define BSIO_POOL_STATS
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+using bsio::impl::Cpu_topology;
+
+void cpu_list() {
+    using bsio::impl::parse_cpu_list;
+    assert((parse_cpu_list("0-3,8,10-11\n") == std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+    // Malformed ranges are ignored
+    assert((parse_cpu_list("x,2,-") == std::vector<unsigned>{2}));
+    assert(parse_cpu_list("").empty());
+}
+
+// On a 1-node host (or without sysfs), NUMA awareness falls back to a single node
+void topology(const std::vector<unsigned> &allowed) {
+    auto flat = Cpu_topology::detect({}, false);
+    assert(flat._nodes.size() == 1);
+    assert(flat.cpus_size() == allowed.size());
+
+    auto numa = Cpu_topology::detect({}, true);
+    assert(!numa._nodes.empty());
+    for(auto &node_cpus : numa._nodes) {
+        for(auto cpu : node_cpus) {
+            assert(std::ranges::count(allowed, cpu) == 1);
+            assert(&numa._nodes[numa.node_of(cpu)] == &node_cpus);
+        }
+    }
+    std::cout << "NUMA nodes: " << numa._nodes.size() << ", CPUs: " << numa.cpus_size() << std::endl;
+
+    // Unknown CPUs are dropped
+    auto one = Cpu_topology::detect({allowed.front(), 1u << 20}, true);
+    assert(one._nodes.size() == 1);
+    assert(one._nodes[0] == std::vector<unsigned>{allowed.front()});
+    assert(one.node_of(-1) == 0);
+}
+
+// Pinned workers run nodes on their CPU
+void pinning(unsigned cpu) {
+    constexpr size_t num_thread = 2;
+    constexpr size_t num_task = 100;
+    bsio::Static_thread_pool pool(num_thread, {.pin_threads = true, .numa_aware = true, .cpus = {cpu}});
+    for(auto &worker : pool.stats().workers) {
+        assert(worker.cpu == static_cast<int>(cpu));
+    }
+
+    std::atomic<size_t> done {0};
+    std::atomic<size_t> misplaced {0};
+    auto ex = bsio::require(pool.executor(), bsio::execution::blocking.never);
+    for(size_t i = 0; i < num_task; ++i) {
+        ex.execute([&] {
+            if(bsio::impl::this_thread_cpu() != static_cast<int>(cpu)) misplaced++;
+            if(++done == num_task) done.notify_one();
+        });
+    }
+    // Not pool.wait(), the calling thread is not pinned
+    for(size_t n; (n = done.load()) != num_task;) done.wait(n);
+    pool.wait();
+    assert(misplaced == 0);
+}
+
+// Not pinned, and NUMA aware without a known topology: works as usual
+void fallback() {
+    bsio::Static_thread_pool pool(4, {.pin_threads = false, .numa_aware = true, .cpus = {}});
+    for(auto &worker : pool.stats().workers) {
+        assert(worker.cpu == -1);
+    }
+    std::atomic<size_t> done {0};
+    for(size_t i = 0; i < 1000; ++i) {
+        pool.executor().execute([&] { done++; });
+    }
+    pool.wait();
+    assert(done == 1000);
+}
+
+int main() {
+    auto allowed = bsio::impl::this_process_cpus();
+    assert(!allowed.empty());
+    cpu_list();
+    topology(allowed);
+    pinning(allowed.back());
+    fallback();
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+constexpr size_t num_batch = 1000;
+
+// Each callable object of a batch runs exactly once
+void count() {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(4);
+    auto ex = pool.executor();
+
+    std::vector<std::atomic<size_t>> hits(num_batch * 2);
+    std::vector<std::function<void()>> batch;
+    for(size_t i = 0; i < num_batch; ++i) {
+        batch.emplace_back([&hits, i] { hits[i]++; });
+    }
+    // An lvalue range is copied
+    bsio::require(ex, blocking.never).execute_batch(batch);
+    assert(batch.size() == num_batch && batch.front());
+
+    // Move-only elements of an rvalue range are moved
+    auto make_move_only = [&hits](size_t i) {
+        return [&hits, i, token = std::make_unique<int>()] { hits[i]++; };
+    };
+    std::vector<decltype(make_move_only(0))> move_only;
+    for(size_t i = num_batch; i < num_batch * 2; ++i) {
+        move_only.push_back(make_move_only(i));
+    }
+    ex.execute_batch(std::move(move_only));
+
+    pool.wait();
+    for(auto &hit : hits) assert(hit == 1);
+}
+
+// Blocking::Always returns after the whole batch is done
+void blocking_always() {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(4);
+    auto ex = bsio::require(pool.executor(), blocking.always);
+
+    std::atomic<size_t> done {0};
+    std::vector<std::function<void()>> batch(num_batch, [&] { done++; });
+    ex.execute_batch(batch);
+    assert(done == num_batch);
+    // Empty batches are fine
+    ex.execute_batch(std::vector<std::function<void()>>{});
+    assert(done == num_batch);
+}
+
+// A continuation batch submitted by a worker runs in order on that worker,
+// as do blocking ones run inline
+void ordering() {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(1);
+    auto ex = pool.executor();
+
+    std::vector<size_t> continuation_order;
+    std::vector<size_t> inline_order;
+    std::atomic<bool> finished {false};
+    ex.execute([&, ex] {
+        std::vector<std::function<void()>> batch;
+        for(size_t i = 0; i < num_batch; ++i) {
+            batch.emplace_back([&, i] {
+                continuation_order.push_back(i);
+                if(i + 1 == num_batch) {
+                    finished = true;
+                    finished.notify_one();
+                }
+            });
+        }
+        bsio::require(bsio::require(ex, blocking.never), relationship.continuation).execute_batch(batch);
+        assert(continuation_order.empty());
+
+        std::vector<std::function<void()>> inline_batch;
+        for(size_t i = 0; i < num_batch; ++i) {
+            inline_batch.emplace_back([&, i] { inline_order.push_back(i); });
+        }
+        bsio::require(ex, blocking.possibly).execute_batch(inline_batch);
+        assert(inline_order.size() == num_batch);
+    });
+    // Not pool.wait(), the calling thread would run (or steal) nodes too
+    finished.wait(false);
+    pool.wait();
+
+    assert(continuation_order.size() == num_batch);
+    for(size_t i = 0; i < num_batch; ++i) {
+        assert(continuation_order[i] == i);
+        assert(inline_order[i] == i);
+    }
+}
+
+int main() {
+    count();
+    blocking_always();
+    ordering();
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+// Flood a pool from outside, then wait()
+// The caller drains the injection queues together with the workers,
+// no worker leaves before the queues are empty
+int main() {
+    constexpr size_t num_thread = 4;
+    constexpr size_t num_task = 1e6;
+    bsio::Static_thread_pool pool(num_thread);
+    auto ex = pool.executor();
+    auto always_ex = bsio::require(ex, bsio::execution::blocking.always);
+
+    std::atomic<size_t> done {0};
+    std::atomic<size_t> resubmitted {0};
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < num_task; ++i) {
+        if(i % 1000) {
+            ex.execute([&] { done.fetch_add(1, std::memory_order_relaxed); });
+        } else {
+            // Submits more while it runs, maybe on the calling thread
+            ex.execute([&, ex]() mutable {
+                for(size_t j = 0; j < 10; ++j) {
+                    ex.execute([&] { resubmitted.fetch_add(1, std::memory_order_relaxed); });
+                }
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+    }
+    // Caller-runs until its own node is done
+    size_t seen = 0;
+    always_ex.execute([&] { seen = 1; });
+    assert(seen == 1);
+
+    pool.wait();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    assert(done == num_task);
+    assert(resubmitted == num_task / 1000 * 10);
+    std::cout << "done: " << done << ", resubmitted: " << resubmitted << ", elapsed: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <cassert>
+#include "bsio.hpp"
+
+// A fire-and-forget coroutine, its frame is destroyed when it returns
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+struct Inline_executor {
+    void execute(std::invocable auto &&func) { func(); }
+};
+
+std::atomic<size_t> done {0};
+
+void finish() {
+    done++;
+    done.notify_one();
+}
+
+// Directionality::Co_await: schedule() and twoway_execute() are awaitables
+Detached co_await_executor(auto ex, std::thread::id caller) {
+    co_await ex.schedule();
+    assert(std::this_thread::get_id() != caller);
+
+    int value = co_await ex.twoway_execute([] { return 42; });
+    assert(value == 42);
+    co_await ex.twoway_execute([] {});
+
+    bool caught = false;
+    try {
+        co_await ex.twoway_execute([]() -> int { throw std::runtime_error("twoway"); });
+    } catch(const std::runtime_error &) {
+        caught = true;
+    }
+    assert(caught);
+    finish();
+}
+
+// Directionality::Oneway: bsio::schedule() resumes through execute()
+Detached co_await_oneway(auto ex, std::thread::id caller) {
+    co_await bsio::schedule(ex);
+    assert(std::this_thread::get_id() != caller);
+    finish();
+}
+
+// Any other oneway executor is resumed by a submitted function object, inline here
+Detached co_await_inline(std::thread::id caller) {
+    co_await bsio::schedule(Inline_executor{});
+    assert(std::this_thread::get_id() == caller);
+    finish();
+}
+
+// Directionality::Twoway and Then: the returned futures are awaitable
+Detached co_await_futures(auto twoway_ex, auto then_ex) {
+    int value = co_await twoway_ex.twoway_execute([] { return 1; });
+    assert(value == 1);
+    value = co_await then_ex.then_execute([] { return 2; });
+    assert(value == 2);
+
+    bool caught = false;
+    try {
+        co_await then_ex.then_execute([] { throw std::runtime_error("then"); });
+    } catch(const std::runtime_error &) {
+        caught = true;
+    }
+    assert(caught);
+    finish();
+}
+
+int main() {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(2);
+    auto ex = pool.executor();
+    auto caller = std::this_thread::get_id();
+
+    co_await_executor(bsio::require(ex, directionality.awaitable), caller);
+    co_await_oneway(ex, caller);
+    co_await_inline(caller);
+    co_await_futures(bsio::require(ex, directionality.twoway), bsio::require(ex, directionality.then));
+
+    // Not pool.wait(), the calling thread would resume coroutines too
+    for(size_t n; (n = done.load()) != 4;) done.wait(n);
+    pool.wait();
+    std::cout << "done!" << std::endl;
+    return 0;
+}
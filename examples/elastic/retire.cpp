@@ -0,0 +1,59 @@
+#define BSIO_POOL_STATS
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+using namespace std::chrono_literals;
+
+// Spin until pred() is true
+// Return: false on timeout
+bool wait_for(auto pred, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(!pred()) {
+        if(std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+int main() {
+    // Idle workers retire after 20ms, down to none
+    // A long spawn_threshold: only new work may bring them back in time
+    bsio::Static_thread_pool pool({
+        .min_threads = 0,
+        .max_threads = 4,
+        .keep_alive = 20ms,
+        .spawn_threshold = 10s
+    });
+    auto ex = pool.executor();
+    assert(pool.stats().active_workers == 0);
+
+    std::atomic<size_t> done {0};
+    auto count = [&] { done.fetch_add(1, std::memory_order_relaxed); };
+
+    for(size_t round = 0; round < 3; ++round) {
+        done = 0;
+        // Sized by the number of active workers, which is 0 now
+        ex.execute(count);
+        ex.bulk_execute([&](size_t) { count(); }, 100);
+        std::vector<std::function<void()>> batch(10, count);
+        ex.execute_batch(batch);
+        bool finished = wait_for([&] { return done == 1 + 100 + 10; }, 5s);
+        std::cout << "round " << round << ": " << done << " done" << std::endl;
+        assert(finished);
+        assert(pool.stats().active_workers > 0);
+
+        // Retired again
+        bool retired = wait_for([&] { return pool.stats().active_workers == 0; }, 5s);
+        assert(retired);
+    }
+
+    pool.wait();
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <future>
+#include <atomic>
+#include <thread>
+#include <cassert>
+#include "execution.hpp"
+
+// Nodes dropped by stop() break their promises,
+// and so do the continuations chained to them
+int main() {
+    std::atomic<bool> busy {true};
+    bsio::Future<int> answer;
+    bsio::Future<int> doubled;
+    {
+        bsio::Static_thread_pool background(1);
+        auto executor = bsio::require(background.executor(), bsio::execution::directionality.twoway);
+        // Keep the only worker busy, so the next node stays queued
+        std::atomic<bool> started {false};
+        background.executor().execute([&] {
+            started = true;
+            while(busy) std::this_thread::yield();
+        });
+        while(!started) std::this_thread::yield();
+
+        answer = executor.twoway_execute([] { return 42; });
+        doubled = executor.twoway_execute([] { return 42; }).then([](int n) { return n * 2; });
+
+        background.stop();
+        busy = false;
+        // The queued nodes are dropped here
+    }
+
+    for(auto *future : {&answer, &doubled}) {
+        try {
+            future->get();
+            assert(false);
+        } catch(const std::future_error &e) {
+            assert(e.code() == std::future_errc::broken_promise);
+            std::cout << e.what() << std::endl;
+        }
+    }
+    return 0;
+}
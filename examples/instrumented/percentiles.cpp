@@ -0,0 +1,100 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using std::chrono::microseconds;
+
+// An upper bound, accurate to 6.25%
+void assert_near(nanoseconds percentile, nanoseconds expected) {
+    assert(percentile >= expected);
+    assert(percentile <= expected + expected / 16);
+}
+
+// Percentiles of known values: 1us, 2us, ..., 1000us
+void known_values() {
+    bsio::Latency_histogram histogram;
+    assert(histogram.percentile(0.5) == 0ns);
+    for(int i = 1; i <= 1000; ++i) {
+        histogram.record(microseconds(i));
+    }
+    assert(histogram.count() == 1000);
+    assert_near(histogram.percentile(0.5), 500us);
+    assert_near(histogram.percentile(0.9), 900us);
+    assert_near(histogram.percentile(0.99), 990us);
+    assert_near(histogram.max(), 1000us);
+    assert(histogram.percentile(0) == histogram.percentile(0.001));
+    // Small values have exact buckets
+    bsio::Latency_histogram small;
+    small.record(3ns, 99);
+    small.record(10ns);
+    assert(small.percentile(0.99) == 3ns);
+    assert(small.max() == 10ns);
+
+    // Shards of a recorder are merged by readers
+    bsio::Task_recorder recorder(4);
+    std::thread threads[4];
+    for(int t = 0; t < 4; ++t) {
+        threads[t] = std::thread([&, t] {
+            for(int i = t + 1; i <= 1000; i += 4) recorder.record_run_time(microseconds(i));
+        });
+    }
+    for(auto &thread : threads) thread.join();
+    auto run_time = recorder.run_time();
+    assert(run_time.count() == 1000);
+    assert(run_time.percentile(0.5) == histogram.percentile(0.5));
+    assert(run_time.percentile(0.99) == histogram.percentile(0.99));
+    assert(recorder.queue_wait().count() == 0);
+    recorder.reset();
+    assert(recorder.run_time().count() == 0);
+}
+
+// Every task of a wrapped executor is recorded, after require() too
+void instrumented() {
+    using namespace bsio::execution;
+    constexpr size_t num_task = 100;
+    constexpr auto sleep_time = 2ms;
+    bsio::Static_thread_pool pool(2);
+    bsio::Task_recorder recorder;
+    bsio::Instrumented_executor ex {pool.executor(), &recorder};
+
+    std::atomic<size_t> done {0};
+    auto never = bsio::require(ex, blocking.never);
+    assert(bsio::query(never, blocking.never));
+    for(size_t i = 0; i < num_task; ++i) {
+        never.execute([&] {
+            std::this_thread::sleep_for(sleep_time);
+            done++;
+        });
+    }
+    auto future = bsio::require(ex, directionality.twoway).twoway_execute([] { return 1; });
+    assert(future.get() == 1);
+    pool.wait();
+    assert(done == num_task);
+
+    auto run_time = recorder.run_time();
+    auto queue_wait = recorder.queue_wait();
+    assert(run_time.count() == num_task + 1);
+    assert(queue_wait.count() == num_task + 1);
+    // All but the twoway one sleep
+    assert(run_time.percentile(0.5) >= sleep_time);
+    assert(run_time.percentile(0.005) < sleep_time);
+    // Two workers and the calling thread: later tasks wait for the earlier ones
+    assert(queue_wait.max() >= sleep_time * (num_task / 3 - 1));
+
+    std::cout << "run time p50: " << run_time.percentile(0.5).count() << "ns"
+              << ", queue wait p50: " << queue_wait.percentile(0.5).count() << "ns"
+              << ", p99: " << queue_wait.percentile(0.99).count() << "ns" << std::endl;
+}
+
+int main() {
+    known_values();
+    instrumented();
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <optional>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+using namespace std::chrono_literals;
+
+int main() {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(2);
+    auto ex = pool.executor();
+
+    std::atomic<size_t> done {0};
+    std::atomic<bool> released {false};
+    std::thread producer;
+    {
+        auto tracked_ex = bsio::require(ex, outstanding_work.tracked);
+        assert(bsio::query(tracked_ex, outstanding_work.tracked));
+        assert(bsio::query(ex, outstanding_work.untracked));
+
+        // A tracked executor counts as outstanding work until it is destroyed,
+        // so wait() keeps the pool running for submissions that come later
+        producer = std::thread([&, tracked = std::optional{tracked_ex}]() mutable {
+            std::this_thread::sleep_for(100ms);
+            for(size_t i = 0; i < 100; ++i) {
+                tracked->execute([&] { done++; });
+            }
+            // Copies are tracked too
+            auto copy = *tracked;
+            tracked.reset();
+            std::this_thread::sleep_for(50ms);
+            copy.execute([&] { done++; });
+            released = true;
+        });
+        // Untracked again, only the producer keeps the pool busy
+        auto untracked_ex = bsio::require(tracked_ex, outstanding_work.untracked);
+        assert(bsio::query(untracked_ex, outstanding_work.untracked));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pool.wait();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    assert(released);
+    assert(done == 101);
+    assert(elapsed >= 100ms);
+    producer.join();
+
+    std::cout << "done: " << done << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+// Heap allocations of the calling thread
+thread_local size_t allocations = 0;
+
+// Not inlined, nor is operator delete,
+// or GCC sees std::free() on a pointer from operator new (-Wmismatched-new-delete)
+[[gnu::noinline]] void* operator new(size_t size) {
+    allocations++;
+    if(auto ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+constexpr size_t num_task = 500;
+
+// Nodes of this thread are taken from its cache below
+void warm_up_nodes() {
+    using Node_pool = bsio::impl::Function_node_pool;
+    std::vector<void*> blocks;
+    blocks.reserve(num_task);
+    for(size_t i = 0; i < num_task; ++i) blocks.push_back(Node_pool::allocate());
+    for(auto block : blocks) Node_pool::deallocate(block);
+}
+
+// No execute_emplace(), the callable object is erased once into a Function
+struct Inline_executor {
+    void execute(std::invocable auto &&func) { func(); }
+
+    bool operator==(const Inline_executor &) const = default;
+};
+
+int main() {
+    using namespace bsio::execution;
+    using Executor = Polymorphic_executor<Directionality::Oneway>;
+    bsio::Static_thread_pool pool(2);
+    Executor ex = pool.executor();
+    std::atomic<size_t> done {0};
+
+    // Small callable objects are constructed in the node directly
+    warm_up_nodes();
+    allocations = 0;
+    for(size_t i = 0; i < num_task - 1; ++i) {
+        ex.execute([&done, i] { done += i < num_task; });
+    }
+    // An lvalue is copied into the node
+    auto lvalue = [&done] { done++; };
+    ex.execute(lvalue);
+    assert(allocations == 0);
+    pool.wait();
+    assert(done == num_task);
+
+    // Larger ones are allocated once, never wrapped again
+    done = 0;
+    bsio::Static_thread_pool pool2(2);
+    ex = pool2.executor();
+    warm_up_nodes();
+    allocations = 0;
+    for(size_t i = 0; i < num_task; ++i) {
+        ex.execute([&done, payload = std::array<size_t, 16>{i}] { done += payload[0] < num_task; });
+    }
+    assert(allocations == num_task);
+    pool2.wait();
+    assert(done == num_task);
+
+    // Other executors receive a Function
+    ex = Inline_executor{};
+    allocations = 0;
+    ex.execute([&done] { done++; });
+    assert(allocations == 0);
+    assert(done == num_task + 1);
+
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+// Heap allocations of the calling thread
+thread_local size_t allocations = 0;
+thread_local size_t deallocations = 0;
+
+// Not inlined, nor is operator delete,
+// or GCC sees std::free() on a pointer from operator new (-Wmismatched-new-delete)
+[[gnu::noinline]] void* operator new(size_t size) {
+    allocations++;
+    if(auto ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+    if(ptr) deallocations++;
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void *ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// Too large for the inline storage
+template <typename Executor>
+struct Large_executor {
+    void execute(std::invocable auto &&func) { _ex.execute(std::forward<decltype(func)>(func)); }
+
+    template <typename Property>
+    auto require(Property property) const
+        -> Large_executor<std::decay_t<decltype(bsio::require(std::declval<const Executor&>(), property))>> {
+        return {bsio::require(_ex, property)};
+    }
+
+    static constexpr bool query(bsio::execution::Outstanding_work_property auto outstanding_work) {
+        return Executor::query(outstanding_work);
+    }
+
+    bool operator==(const Large_executor &) const = default;
+
+    Executor _ex;
+    char _padding[64] {};
+};
+
+using namespace bsio::execution;
+using Executor = Polymorphic_executor<Directionality::Oneway, Blocking::Never,
+                                      Outstanding_work::Tracked, Outstanding_work::Untracked>;
+using Pool_executor = bsio::Static_thread_pool::Executor_type;
+
+static_assert(polymorphic_impl::fits_inline<Pool_executor>);
+static_assert(!polymorphic_impl::fits_inline<Large_executor<Pool_executor>>);
+
+// Small executors live in the polymorphic executor itself, nothing is allocated
+void inline_storage(Pool_executor pool_ex) {
+    allocations = deallocations = 0;
+    {
+        Executor ex = pool_ex;
+        Executor copy = ex;
+        Executor moved = std::move(copy);
+        auto never = bsio::require(moved, blocking.never);
+        auto tracked = bsio::require(never, outstanding_work.tracked);
+        assert(tracked.query(outstanding_work.tracked));
+        ex = tracked;
+        ex = std::move(never);
+    }
+    assert(allocations == 0 && deallocations == 0);
+}
+
+// Large executors are shared on the heap
+void heap_fallback(Pool_executor pool_ex) {
+    allocations = deallocations = 0;
+    {
+        Executor ex = Large_executor<Pool_executor>{pool_ex};
+        assert(allocations == 1);
+        // Copies share the same one
+        Executor copy = ex;
+        Executor moved = std::move(copy);
+        assert(allocations == 1);
+
+        // Results of stateless properties are memoized: made once, shared later
+        auto never = bsio::require(ex, blocking.never);
+        assert(allocations == 2);
+        never = bsio::require(ex, blocking.never);
+        never = bsio::require(moved, blocking.never);
+        assert(allocations == 2);
+
+        // Tracked results are never memoized
+        for(size_t i = 1; i <= 3; ++i) {
+            auto tracked = bsio::require(ex, outstanding_work.tracked);
+            assert(allocations == 2 + i);
+        }
+        assert(deallocations == 3);
+    }
+    // Including the memoized result
+    assert(deallocations == allocations);
+}
+
+int main() {
+    bsio::Static_thread_pool pool(1);
+    inline_storage(pool.executor());
+    heap_fallback(pool.executor());
+    pool.wait();
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+// Too large for the inline storage, so it is shared on the heap
+// and its conversions to stateless properties are memoized
+template <typename Executor>
+struct Labeled_executor {
+    void execute(std::invocable auto &&func) { _ex.execute(std::forward<decltype(func)>(func)); }
+
+    auto require(bsio::execution::Outstanding_work_property auto outstanding_work) const {
+        return Labeled_executor<decltype(_ex.require(outstanding_work))>{_ex.require(outstanding_work), _label};
+    }
+
+    static constexpr bool query(bsio::execution::Outstanding_work_property auto outstanding_work) {
+        return Executor::query(outstanding_work);
+    }
+
+    bool operator==(const Labeled_executor &) const = default;
+
+    Executor _ex;
+    const char *_label;
+    char _padding[64] {};
+};
+
+int main() {
+    using namespace bsio::execution;
+    using Executor = Polymorphic_executor<Directionality::Oneway,
+                                          Outstanding_work::Tracked, Outstanding_work::Untracked>;
+    bsio::Static_thread_pool pool(2);
+    std::atomic<size_t> done {0};
+
+    // Lives until the end of main()
+    Executor ex = Labeled_executor<bsio::Static_thread_pool::Executor_type>{pool.executor(), "pool"};
+    assert(!ex.query(outstanding_work.tracked));
+    {
+        // Keeps the pool busy during its lifetime only
+        auto tracked = bsio::require(ex, outstanding_work.tracked);
+        assert(tracked.query(outstanding_work.tracked));
+        tracked.execute([&] { done++; });
+        // Untracked results are memoized, and shared by later conversions
+        auto untracked = bsio::require(ex, outstanding_work.untracked);
+        untracked = bsio::require(ex, outstanding_work.untracked);
+        assert(!untracked.query(outstanding_work.tracked));
+        untracked.execute([&] { done++; });
+    }
+
+    // Returns, no tracked executor is kept by ex
+    pool.wait();
+    assert(done == 2);
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,16 @@
+#include <string>
+#include <cassert>
+#include "bsio.hpp"
+#include "executors/Static_thread_pool.hpp"
+
+int main() {
+    bsio::Static_thread_pool pool(4);
+    auto ex = pool.executor();
+
+    auto work = bsio::when_all(
+        bsio::schedule(ex) | bsio::then([] { return 1; }),
+        bsio::schedule(ex) | bsio::then([] { return std::string("two"); }));
+
+    auto [one, two] = bsio::sync_wait(std::move(work));
+    assert(one == 1 && two == "two");
+}
@@ -0,0 +1,121 @@
+#define BSIO_POOL_STATS
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+using namespace std::chrono_literals;
+
+constexpr size_t num_thread = 2;
+constexpr size_t num_task = 1000;
+constexpr size_t num_sleep = 20;
+constexpr auto sleep_time = 5ms;
+// Fewer than the bound of a run-next chain, all of them run on the submitting worker
+constexpr size_t num_continuation = 32;
+
+struct Totals {
+    uint64_t tasks = 0;
+    uint64_t injected = 0;
+    uint64_t steals = 0;
+    uint64_t parks = 0;
+    uint64_t wakeups = 0;
+    std::chrono::nanoseconds busy {};
+};
+
+Totals totals(const bsio::Static_thread_pool::Stats &stats) {
+    Totals totals;
+    for(auto &worker : stats.workers) {
+        totals.tasks += worker.tasks;
+        totals.injected += worker.injected;
+        totals.steals += worker.steals;
+        totals.parks += worker.parks;
+        totals.wakeups += worker.wakeups;
+        totals.busy += worker.busy;
+        if(worker.tasks) assert(worker.latency_max * worker.tasks >= worker.latency_sum);
+    }
+    return totals;
+}
+
+int main() {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(num_thread);
+    auto ex = bsio::require(pool.executor(), blocking.never);
+    std::atomic<size_t> done {0};
+    auto finish = [&] {
+        done++;
+        done.notify_one();
+    };
+
+    // Submitted by a non-worker thread: every node is taken from an injection queue
+    for(size_t i = 0; i < num_task; ++i) {
+        ex.execute([&, i] {
+            if(i < num_sleep) std::this_thread::sleep_for(sleep_time);
+            finish();
+        });
+    }
+    // Continuations of a worker skip the injection queues
+    ex.execute([&, ex] {
+        for(size_t i = 0; i < num_continuation; ++i) {
+            bsio::require(ex, relationship.continuation).execute(finish);
+        }
+        finish();
+    });
+    // Not pool.wait(), the calling thread would run nodes too
+    for(size_t n; (n = done.load()) != num_task + 1 + num_continuation;) done.wait(n);
+
+    // All workers are blocked, only the calling thread can run the next node
+    std::atomic<size_t> started {0};
+    std::atomic<bool> released {false};
+    for(size_t i = 0; i < num_thread; ++i) {
+        ex.execute([&] {
+            started++;
+            started.notify_one();
+            released.wait(false);
+        });
+    }
+    for(size_t n; (n = started.load()) != num_thread;) started.wait(n);
+    ex.execute(finish);
+    assert(pool.run_one());
+
+    auto running = pool.stats();
+    assert(running.workers.size() == num_thread);
+    assert(running.active_workers == num_thread);
+    for(auto &worker : running.workers) {
+        assert(worker.alive);
+        assert(worker.cpu == -1);
+    }
+    released = true;
+    released.notify_all();
+    // Workers are joined, all counters are published
+    pool.wait();
+
+    // All nodes, including the blocking ones and the one run by the calling thread
+    constexpr size_t expected = num_task + 1 + num_continuation + num_thread + 1;
+    assert(done == expected - num_thread);
+
+    auto stats = pool.stats();
+    assert(stats.outstanding_work == 0);
+    assert(stats.pending_injection_queues == 0);
+    for(auto &worker : stats.workers) {
+        assert(!worker.alive);
+    }
+    assert(stats.external.tasks == 1);
+    assert(stats.external.latency_max == stats.external.latency_sum);
+
+    auto worker_totals = totals(stats);
+    assert(worker_totals.tasks == expected - 1);
+    assert(worker_totals.injected == expected - 1 - num_continuation);
+    assert(worker_totals.wakeups <= worker_totals.parks);
+    assert(worker_totals.busy >= num_sleep * sleep_time);
+
+    std::cout << "tasks: " << worker_totals.tasks << " + " << stats.external.tasks
+              << ", injected: " << worker_totals.injected
+              << ", steals: " << worker_totals.steals
+              << ", parks: " << worker_totals.parks
+              << ", busy: " << std::chrono::duration_cast<std::chrono::milliseconds>(worker_totals.busy).count() << "ms"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include "execution.hpp"
+#include "property.hpp"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// Timers of different levels fire in deadline order, never early
+void firing_order() {
+    bsio::Static_thread_pool pool(2);
+    auto ex = pool.executor();
+
+    // > 64ms: placed at level 1 of the wheel, and cascaded to level 0 later
+    constexpr std::chrono::milliseconds delays[] {50ms, 10ms, 130ms, 70ms, 30ms, 200ms};
+    std::mutex mutex;
+    std::vector<std::pair<size_t, Clock::duration>> fired;
+
+    auto start = Clock::now();
+    for(size_t i = 0; i < std::size(delays); ++i) {
+        ex.execute_after(delays[i], [&, i] {
+            auto elapsed = Clock::now() - start;
+            std::lock_guard lock {mutex};
+            fired.emplace_back(i, elapsed);
+        });
+    }
+    // Also waits for pending timers
+    pool.wait();
+
+    assert(fired.size() == std::size(delays));
+    for(size_t n = 0; n < fired.size(); ++n) {
+        auto [i, elapsed] = fired[n];
+        auto lateness = elapsed - delays[i];
+        std::cout << "timer " << delays[i].count() << "ms, late "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(lateness).count() << "us" << std::endl;
+        assert(lateness >= 0ms);
+        assert(lateness < 100ms);
+        if(n) assert(delays[fired[n-1].first] < delays[i]);
+    }
+}
+
+// Deadlines of other clocks are converted once
+void other_clock() {
+    bsio::Static_thread_pool pool(1);
+    auto deadline = std::chrono::system_clock::now() + 20ms;
+    std::atomic<bool> fired {false};
+    pool.executor().execute_at(deadline, [&] {
+        assert(std::chrono::system_clock::now() >= deadline - 1ms);
+        fired = true;
+    });
+    pool.wait();
+    assert(fired);
+}
+
+// Pending timers are dropped by stop(), their functions are destroyed but never invoked
+// The keeper (a parked worker sleeping until the nearest deadline) leaves at once
+void cancellation() {
+    auto token = std::make_shared<int>();
+    std::atomic<bool> fired {false};
+    auto start = Clock::now();
+    {
+        bsio::Static_thread_pool pool(2);
+        auto ex = pool.executor();
+        ex.execute_after(10s, [&fired, token] { fired = true; });
+        ex.execute_after(1h, [&fired, token] { fired = true; });
+        assert(token.use_count() == 3);
+        // Let a worker become the keeper
+        std::this_thread::sleep_for(20ms);
+        pool.stop();
+    }
+    auto elapsed = Clock::now() - start;
+    assert(!fired);
+    assert(token.use_count() == 1);
+    assert(elapsed < 1s);
+}
+
+// Cascading through the levels of the wheel (64 ticks per slot of level 1, 4096 of level 2...)
+// Each node expires exactly at its deadline
+void wheel_cascading() {
+    using namespace bsio::impl;
+    Timer_wheel wheel;
+    constexpr uint64_t deadlines[] {300000, 5, 5000, 100, 64, 4096, 262144};
+    std::vector<uint64_t> expired;
+    for(auto deadline : deadlines) {
+        auto node = Function_node::make([] {}, std::allocator<void>{});
+        assert(!wheel.insert(Timer_node::make(std::move(node), deadline)));
+    }
+    assert(wheel.size() == std::size(deadlines));
+
+    while(!wheel.empty()) {
+        // May be a cascade point, no node expires there
+        auto next = wheel.next_deadline();
+        wheel.advance(next, [&](Timer_node_handle timer) {
+            assert(timer->_deadline == next);
+            expired.push_back(next);
+        });
+    }
+    assert(wheel.next_deadline() == Timer_wheel::never);
+
+    std::vector<uint64_t> sorted(std::begin(deadlines), std::end(deadlines));
+    std::ranges::sort(sorted);
+    assert(expired == sorted);
+}
+
+int main() {
+    firing_order();
+    other_clock();
+    cancellation();
+    wheel_cascading();
+    std::cout << "done!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#define BSIO_POOL_TRACE
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+#include "bsio.hpp"
+
+constexpr size_t num_post = 200;
+constexpr size_t num_defer = 100;
+constexpr size_t num_batch = 100;
+// Longer than a run-next chain, cut and published again
+constexpr size_t num_chain = 100;
+// Including the one submitting defers and the batch
+constexpr size_t num_task = num_post + num_defer + num_batch + 1 + num_chain;
+
+// A field of a dumped event, one event per line
+std::string field(const std::string &line, const std::string &key) {
+    auto pos = line.find("\"" + key + "\":");
+    if(pos == std::string::npos) return {};
+    pos += key.size() + 3;
+    if(line[pos] == '"') {
+        return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+    }
+    return line.substr(pos, line.find_first_of(",}", pos) - pos);
+}
+
+int main(int argc, char *argv[]) {
+    using namespace bsio::execution;
+    bsio::Static_thread_pool pool(2);
+    auto ex = pool.executor();
+    std::atomic<size_t> done {0};
+    auto finish = [&] {
+        if(++done == num_task) done.notify_one();
+    };
+
+    for(size_t i = 0; i < num_post; ++i) {
+        bsio::post(ex, finish);
+    }
+    // Defers and a batch submitted by a worker
+    bsio::require(ex, blocking.never).execute([&, ex] {
+        for(size_t i = 0; i < num_defer; ++i) {
+            bsio::defer(ex, finish);
+        }
+        std::vector<std::function<void()>> batch(num_batch, finish);
+        bsio::require(ex, blocking.never).execute_batch(batch);
+        finish();
+    });
+    // Each step defers the next one
+    std::atomic<size_t> steps {0};
+    std::function<void()> step = [&] {
+        if(++steps < num_chain) bsio::defer(ex, step);
+        finish();
+    };
+    bsio::require(ex, blocking.never).execute(step);
+    // Not pool.wait() at once, the calling thread would run the chain too
+    for(size_t n; (n = done.load()) != num_task;) done.wait(n);
+    pool.wait();
+
+    std::ostringstream os;
+    bsio::write_chrome_trace(os);
+    // ./trace trace.json, then open it with chrome://tracing or https://ui.perfetto.dev
+    if(argc > 1) std::ofstream {argv[1]} << os.str();
+
+    std::map<std::string, long> depths;
+    std::map<std::string, long> flows;
+    std::vector<std::pair<double, std::string>> flow_events;
+    size_t tasks = 0;
+    std::istringstream lines {os.str()};
+    for(std::string line; std::getline(lines, line);) {
+        auto ph = field(line, "ph");
+        auto tid = field(line, "tid");
+        if(ph == "B") {
+            depths[tid]++;
+            if(field(line, "name") == "task") tasks++;
+        } else if(ph == "E") {
+            assert(--depths[tid] >= 0);
+        } else if(ph == "s" || ph == "f") {
+            flow_events.emplace_back(std::stod(field(line, "ts")), ph + field(line, "id"));
+        }
+    }
+    // B/E events balance on every thread
+    for(auto &[tid, depth] : depths) assert(depth == 0);
+    // Every flow ends after its start, node addresses are reused by later flows
+    std::ranges::stable_sort(flow_events, {}, &std::pair<double, std::string>::first);
+    size_t starts = 0;
+    for(auto &[ts, event] : flow_events) {
+        auto &flow = flows[event.substr(1)];
+        if(event[0] == 's') {
+            ++flow;
+            ++starts;
+        } else {
+            assert(--flow >= 0);
+        }
+    }
+    for(auto &[id, flow] : flows) assert(flow == 0);
+    assert(starts == num_task);
+    assert(tasks == num_task);
+
+    std::cout << "threads: " << depths.size() << ", tasks: " << tasks << std::endl;
+    return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "execution.hpp"
 #include "property.hpp"
+#include "executors/Senders.hpp"
 
 namespace bsio {
 
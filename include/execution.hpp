@@ -8,6 +8,8 @@
 #include "executors/Context.hpp"
 #include "executors/Static_thread_pool.hpp"
 #include "executors/Polymorphic_executor.hpp"
+#include "executors/Instrumented_executor.hpp"
+#include "executors/Trace.hpp"
 
 // Notes on execution:
 //
@@ -17,15 +17,20 @@ struct Directionality: impl::directionality_impl::Top_class_property<Directional
     struct Twoway
         : impl::directionality_impl::Property<Twoway> {};
     
-    // See examples: future_then
+    // Static_thread_pool, see also examples: future_then
     struct Then
         : impl::directionality_impl::Property<Then> {};
     
-    // TODO struct Co_await;
+    // C++20 stackless coroutines
+    // See also: bsio::schedule()
+    struct Co_await
+        : impl::directionality_impl::Property<Co_await> {};
 
     inline static constexpr Oneway oneway {};
     inline static constexpr Twoway twoway {};
     inline static constexpr Then then {};
+    // `co_await` is a keyword
+    inline static constexpr Co_await awaitable {};
 };
 
 inline constexpr Directionality directionality {};
@@ -35,43 +40,47 @@ concept Directionality_property = impl::directionality_impl::Directionality_prop
 
 template <typename ...Supportable_properties>
 class Directionality::Oneway::Polymorphic_executor_type {
+    // See polymorphic_impl::property_id
+    template <typename Property>
+    static constexpr size_t id_of =
+        polymorphic_impl::property_id<std::decay_t<Property>, Supportable_properties...>;
+
 public:
     Polymorphic_executor_type(): _pimpl(nullptr) {}
 
     Polymorphic_executor_type(std::nullptr_t): _pimpl(nullptr) {}
 
-    ~Polymorphic_executor_type() { _pimpl ? _pimpl->destroy() : (void)0; }
+    ~Polymorphic_executor_type() { reset(); }
 
     Polymorphic_executor_type(const Polymorphic_executor_type &e)
-        : _pimpl(e._pimpl ? e._pimpl->clone() : nullptr) {}
+        : _pimpl(e._pimpl ? e._pimpl->clone(_storage) : nullptr) {}
 
-    Polymorphic_executor_type(Polymorphic_executor_type &&e)
-        : _pimpl(e._pimpl) { e._pimpl = nullptr; }
+    Polymorphic_executor_type(Polymorphic_executor_type &&e) noexcept
+        : _pimpl(e.release(_storage)) {}
 
     template <typename Executor,
         typename Impl = polymorphic_impl::Polymorphic_executor<
             std::decay_t<Executor>, Supportable_properties...>,
         typename = std::enable_if_t<!std::is_same_v<std::decay_t<Executor>, Polymorphic_executor_type>>>
     Polymorphic_executor_type(Executor &&e)
-        : _pimpl(new Impl(std::forward<Executor>(e))) {}
+        : _pimpl(Impl::make(_storage, std::forward<Executor>(e))) {}
 
     Polymorphic_executor_type& operator=(std::nullptr_t) {
-        this->~Polymorphic_executor_type();
+        reset();
         return *this;
     }
 
     Polymorphic_executor_type& operator=(const Polymorphic_executor_type &e) {
         if(&e == this) return *this;
-        this->~Polymorphic_executor_type();
-        _pimpl = e._pimpl->clone();
+        reset();
+        _pimpl = e._pimpl ? e._pimpl->clone(_storage) : nullptr;
         return *this;
     }
 
-    Polymorphic_executor_type& operator=(Polymorphic_executor_type &&e) {
+    Polymorphic_executor_type& operator=(Polymorphic_executor_type &&e) noexcept {
         if(&e == this) return *this;
-        this->~Polymorphic_executor_type();
-        _pimpl = e._pimpl;
-        e._pimpl = nullptr;
+        reset();
+        _pimpl = e.release(_storage);
         return *this;
     }
 
@@ -80,23 +89,62 @@ public:
         return this->operator=(Polymorphic_executor_type(std::forward<Executor>(e)));
     }
 
-    Polymorphic_executor_type require(auto property) const {
-        return _pimpl->require(typeid(property), std::addressof(property));
+    // Only Supportable_properties can be required
+    // Return: an empty executor if the target cannot require it
+    template <typename Property>
+        requires (id_of<Property> != polymorphic_impl::unsupported_property)
+    Polymorphic_executor_type require(Property property) const {
+        Polymorphic_executor_type ex;
+        ex._pimpl = _pimpl->require(id_of<Property>, std::addressof(property), ex._storage);
+        return ex;
+    }
+
+    // Return: a copy if the property is not supportable, or the target cannot prefer it
+    template <typename Property>
+    Polymorphic_executor_type prefer(Property property) const {
+        if constexpr (id_of<Property> == polymorphic_impl::unsupported_property) {
+            return *this;
+        } else {
+            Polymorphic_executor_type ex;
+            ex._pimpl = _pimpl->prefer(id_of<Property>, std::addressof(property), ex._storage);
+            return ex;
+        }
     }
 
-    Polymorphic_executor_type prefer(auto property) const {
-        return _pimpl->prefer(typeid(property), std::addressof(property));
+    // Only Supportable_properties can be queried
+    // Return: Property::polymorphic_query_result_type (bool by default),
+    //         value-initialized if the target cannot answer
+    template <typename Property>
+        requires (id_of<Property> != polymorphic_impl::unsupported_property)
+    auto query(Property property) const -> polymorphic_impl::Query_result_t<Property> {
+        polymorphic_impl::Query_result_t<Property> result {};
+        _pimpl->query(id_of<Property>, std::addressof(property), std::addressof(result));
+        return result;
     }
 
 public:
-    void execute(std::invocable auto &&f) { _pimpl->execute(std::forward<decltype(f)>(f)); }
+    void execute(std::invocable auto &&f) {
+        _pimpl->execute(bsio::impl::Function_emplacer::of(std::forward<decltype(f)>(f)));
+    }
 
 private:
-    Polymorphic_executor_type(polymorphic_impl::Polymorphic_executor_base *pimpl): _pimpl(pimpl) {}
+    void reset() noexcept {
+        if(_pimpl) _pimpl->destroy();
+        _pimpl = nullptr;
+    }
+
+    // Hand over the executor, which moves to `storage` if it is inline
+    polymorphic_impl::Polymorphic_executor_base* release(void *storage) noexcept {
+        auto pimpl = _pimpl ? _pimpl->relocate(storage) : nullptr;
+        _pimpl = nullptr;
+        return pimpl;
+    }
 
 private:
-    // Note: `_pimpl` is a reference-counted pointer, don't delete(_pimpl) in destructor
+    // Either points to `_storage`, or to a reference-counted executor on the heap
+    // Note: don't delete(_pimpl) in destructor, see destroy()
     polymorphic_impl::Polymorphic_executor_base *_pimpl;
+    alignas(void*) std::byte _storage[polymorphic_impl::inline_size];
 };
 
 } // namespace execution
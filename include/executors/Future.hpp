@@ -0,0 +1,228 @@
+#pragma once
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <coroutine>
+#include "impl/Future_state.hpp"
+namespace bsio {
+
+template <typename T>
+class Future;
+
+template <typename T>
+class Promise;
+
+
+// Returned by twoway_execute()
+//
+// Like std::future, but the shared state is a pooled block
+// without any mutex, and continuations are supported:
+//     ex.twoway_execute(f).then(g).then(h);
+// Continuations are submitted to the scheduler of the promise (e.g. the pool)
+template <typename T>
+class Future {
+public:
+    Future() noexcept = default;
+    Future(Future &&rhs) noexcept: _state(std::exchange(rhs._state, nullptr)) {}
+    Future& operator=(Future rhs) noexcept { std::swap(_state, rhs._state); return *this; }
+    ~Future() { if(_state) _state->release(); }
+
+    bool valid() const noexcept { return _state; }
+
+    bool is_ready() const noexcept { assert(valid()); return _state->is_ready(); }
+
+    void wait() const { assert(valid()); _state->wait(); }
+
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period> &timeout) const;
+
+    // Invalidate this future
+    // The stored exception is rethrown if any
+    T get();
+
+    // Invoke f(T&&) (or f() for void) after this future is ready
+    // An exception is forwarded to the returned future, f is skipped
+    // Invalidate this future
+    template <typename F>
+    auto then(F &&f) { assert(valid()); return then(std::forward<F>(f), _state->_scheduler); }
+
+    // Submit f (and continuations of the returned future) to `scheduler` instead
+    template <typename F>
+    auto then(F &&f, impl::Future_scheduler scheduler);
+
+    // co_await std::move(future)
+    // The coroutine is resumed as a continuation, see then()
+    auto operator co_await() && noexcept;
+
+private:
+    class Awaiter;
+
+    friend class Promise<T>;
+
+    explicit Future(impl::Future_state<T> *state) noexcept: _state(state) {}
+
+    impl::Future_state<T> *_state {nullptr};
+};
+
+
+// The producer side of a Future
+// An unsatisfied promise stores std::future_errc::broken_promise on destruction
+template <typename T>
+class Promise {
+public:
+    explicit Promise(impl::Future_scheduler scheduler = {})
+        : _state(impl::Future_state<T>::make(scheduler)) {}
+
+    Promise(Promise &&rhs) noexcept
+        : _state(std::exchange(rhs._state, nullptr)),
+          _future_retrieved(rhs._future_retrieved) {}
+
+    Promise& operator=(Promise rhs) noexcept {
+        std::swap(_state, rhs._state);
+        std::swap(_future_retrieved, rhs._future_retrieved);
+        return *this;
+    }
+
+    ~Promise();
+
+    // Can be called only once
+    Future<T> get_future();
+
+    template <typename ...Args>
+    void set_value(Args &&...args);
+
+    void set_exception(std::exception_ptr exception);
+
+    // Store the result of f(args...), or the exception it throws
+    template <typename F, typename ...Args>
+    void set_value_from(F &&f, Args &&...args);
+
+private:
+    impl::Future_state<T> *_state;
+    bool _future_retrieved {false};
+};
+
+
+template <typename T>
+template <typename Rep, typename Period>
+inline std::future_status Future<T>::wait_for(const std::chrono::duration<Rep, Period> &timeout) const {
+    assert(valid());
+    auto deadline = impl::Futex::Clock::now()
+        + std::chrono::ceil<impl::Futex::Clock::duration>(timeout);
+    return _state->wait_until(deadline) ? std::future_status::ready : std::future_status::timeout;
+}
+
+template <typename T>
+inline T Future<T>::get() {
+    assert(valid());
+    _state->wait();
+    // Released on return, after the result is moved out
+    Future holder {std::exchange(_state, nullptr)};
+    auto &result = holder._state->_result;
+    if(auto exception = std::get_if<2>(&result)) {
+        std::rethrow_exception(*exception);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(std::get<1>(result));
+    }
+}
+
+template <typename T>
+template <typename F>
+inline auto Future<T>::then(F &&f, impl::Future_scheduler scheduler) {
+    assert(valid());
+    using Ret = std::conditional_t<std::is_void_v<T>,
+        std::invoke_result<std::decay_t<F>&>,
+        std::invoke_result<std::decay_t<F>&, std::add_rvalue_reference_t<T>>>::type;
+    auto state = _state;
+    Promise<Ret> promise {scheduler};
+    auto future = promise.get_future();
+    // The consumer reference is moved to the continuation,
+    // released even if the continuation is dropped (e.g. stopped)
+    state->attach([source = std::move(*this), promise = std::move(promise), f = std::forward<F>(f)]() mutable {
+        auto &result = source._state->_result;
+        if(auto exception = std::get_if<2>(&result)) {
+            promise.set_exception(*exception);
+        } else if constexpr (std::is_void_v<T>) {
+            promise.set_value_from(f);
+        } else {
+            promise.set_value_from(f, std::move(std::get<1>(result)));
+        }
+    }, scheduler);
+    return future;
+}
+
+template <typename T>
+class Future<T>::Awaiter {
+public:
+    explicit Awaiter(Future future) noexcept: _future(std::move(future)) {}
+
+    bool await_ready() const noexcept { return _future.is_ready(); }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        auto state = _future._state;
+        state->attach([handle] { handle.resume(); }, state->_scheduler);
+    }
+
+    T await_resume() { return _future.get(); }
+
+private:
+    Future _future;
+};
+
+template <typename T>
+inline auto Future<T>::operator co_await() && noexcept {
+    assert(valid());
+    return Awaiter{std::move(*this)};
+}
+
+template <typename T>
+inline Promise<T>::~Promise() {
+    if(!_state) return;
+    if(!_state->is_ready()) {
+        set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+    }
+    _state->release();
+    // The consumer reference is never taken
+    if(!_future_retrieved) _state->release();
+}
+
+template <typename T>
+inline Future<T> Promise<T>::get_future() {
+    assert(_state && !_future_retrieved);
+    _future_retrieved = true;
+    return Future<T>{_state};
+}
+
+template <typename T>
+template <typename ...Args>
+inline void Promise<T>::set_value(Args &&...args) {
+    assert(_state);
+    _state->set_value(std::forward<Args>(args)...);
+}
+
+template <typename T>
+inline void Promise<T>::set_exception(std::exception_ptr exception) {
+    assert(_state);
+    _state->set_exception(std::move(exception));
+}
+
+template <typename T>
+template <typename F, typename ...Args>
+inline void Promise<T>::set_value_from(F &&f, Args &&...args) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            std::invoke(std::forward<F>(f), std::forward<Args>(args)...);
+            set_value();
+        } else {
+            set_value(std::invoke(std::forward<F>(f), std::forward<Args>(args)...));
+        }
+    } catch(...) {
+        set_exception(std::current_exception());
+    }
+}
+
+} // namespace bsio
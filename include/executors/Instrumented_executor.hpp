@@ -0,0 +1,270 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <type_traits>
+#include <thread>
+#include "property.hpp"
+#include "impl/Histogram.hpp"
+namespace bsio {
+
+// A merged histogram of durations
+// Percentiles are accurate to 6.25%, see impl::Log_linear_buckets
+class Latency_histogram {
+public:
+    using Buckets = impl::Log_linear_buckets;
+
+    Latency_histogram(): _buckets(Buckets::size) {}
+
+    uint64_t count() const noexcept { return _count; }
+
+    // q in [0, 1], e.g. 0.99 for p99
+    // Return: the upper bound of the bucket, 0 if empty
+    std::chrono::nanoseconds percentile(double q) const;
+
+    std::chrono::nanoseconds max() const { return percentile(1); }
+
+    void record(std::chrono::nanoseconds duration, uint64_t count = 1);
+
+    void merge(const Latency_histogram &other);
+
+    void merge(const impl::Atomic_histogram &other);
+
+private:
+    std::vector<uint64_t> _buckets;
+    uint64_t _count {0};
+};
+
+
+// Queue-wait and run-time histograms shared by instrumented executors
+//
+// Recorders are sharded, each thread sticks to one shard (relaxed RMW only),
+// and shards are merged by readers without stopping writers
+// Call queue_wait()/run_time() periodically for a moving picture,
+// and reset() to start a new period
+class Task_recorder {
+public:
+    // Default: one shard per hardware thread
+    explicit Task_recorder(size_t shards = std::thread::hardware_concurrency());
+
+    Task_recorder(const Task_recorder &) = delete;
+    Task_recorder& operator=(const Task_recorder &) = delete;
+
+    void record_queue_wait(std::chrono::nanoseconds duration) noexcept;
+
+    void record_run_time(std::chrono::nanoseconds duration) noexcept;
+
+    // From execute() to the start of a task
+    Latency_histogram queue_wait() const;
+
+    // From the start to the end of a task, including exceptional ends
+    Latency_histogram run_time() const;
+
+    // Note: concurrent records may be partially dropped
+    void reset() noexcept;
+
+private:
+    struct alignas(64) Shard {
+        impl::Atomic_histogram _queue_wait;
+        impl::Atomic_histogram _run_time;
+    };
+
+    Shard& this_thread_shard() noexcept;
+
+    std::unique_ptr<Shard[]> _shards;
+    size_t _shards_size;
+};
+
+
+// Wrap any executor, record every task in a Task_recorder
+//
+// require/prefer return a wrapped executor, query is forwarded to the wrapped one
+// (static queries stay static), so it is a drop-in replacement:
+//     Task_recorder recorder;
+//     Instrumented_executor ex {pool.executor(), &recorder};
+//     bsio::require(ex, execution::blocking.never).execute(f);
+//     recorder.queue_wait().percentile(0.99);
+// Note: the recorder is not owned, it must outlive all executors using it
+template <typename Executor>
+class Instrumented_executor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Instrumented_executor(Executor ex, Task_recorder *recorder)
+        : _ex(std::move(ex)), _recorder(recorder) {}
+
+    bool operator==(const Instrumented_executor &) const = default;
+
+    template <typename Property>
+    auto require(Property property) const
+        -> Instrumented_executor<std::decay_t<decltype(bsio::require(std::declval<const Executor&>(), property))>>
+    {
+        return {bsio::require(_ex, property), _recorder};
+    }
+
+    template <typename Property>
+    auto prefer(Property property) const
+        -> Instrumented_executor<std::decay_t<decltype(bsio::prefer(std::declval<const Executor&>(), property))>>
+    {
+        return {bsio::prefer(_ex, property), _recorder};
+    }
+
+    template <typename Property>
+        requires requires { Property::template static_query_v<Executor>; }
+    static constexpr decltype(auto) query(Property) {
+        return Property::template static_query_v<Executor>;
+    }
+
+    template <typename Property>
+        requires (!requires { Property::template static_query_v<Executor>; })
+            && requires(const Executor &ex, Property property) { bsio::query(ex, property); }
+    decltype(auto) query(Property property) const {
+        return bsio::query(_ex, property);
+    }
+
+    void execute(std::invocable auto &&functor)
+        requires requires(Executor &ex, void (*f)()) { ex.execute(f); };
+
+    auto twoway_execute(std::invocable auto &&functor)
+        requires requires(Executor &ex, void (*f)()) { ex.twoway_execute(f); };
+
+    // The wrapped executor
+    const Executor& base() const noexcept { return _ex; }
+
+    Task_recorder* recorder() const noexcept { return _recorder; }
+
+private:
+    // Record the queue wait on construction, the run time on destruction
+    class Run_scope;
+
+    auto instrument(auto &&functor);
+
+    Executor _ex;
+    Task_recorder *_recorder;
+};
+
+
+template <typename Executor>
+class Instrumented_executor<Executor>::Run_scope {
+public:
+    Run_scope(Task_recorder *recorder, Clock::time_point enqueued) noexcept
+        : _recorder(recorder), _started(Clock::now())
+    {
+        _recorder->record_queue_wait(_started - enqueued);
+    }
+
+    ~Run_scope() { _recorder->record_run_time(Clock::now() - _started); }
+
+    Run_scope(const Run_scope &) = delete;
+    Run_scope& operator=(const Run_scope &) = delete;
+
+private:
+    Task_recorder *_recorder;
+    Clock::time_point _started;
+};
+
+template <typename Executor>
+inline auto Instrumented_executor<Executor>::instrument(auto &&functor) {
+    // Two more words to capture, still small enough for inline storage in most cases
+    return [recorder = _recorder, enqueued = Clock::now(),
+            functor = std::forward<decltype(functor)>(functor)]() mutable -> decltype(auto) {
+        Run_scope scope {recorder, enqueued};
+        return std::invoke(functor);
+    };
+}
+
+template <typename Executor>
+inline void Instrumented_executor<Executor>::execute(std::invocable auto &&functor)
+    requires requires(Executor &ex, void (*f)()) { ex.execute(f); }
+{
+    _ex.execute(instrument(std::forward<decltype(functor)>(functor)));
+}
+
+template <typename Executor>
+inline auto Instrumented_executor<Executor>::twoway_execute(std::invocable auto &&functor)
+    requires requires(Executor &ex, void (*f)()) { ex.twoway_execute(f); }
+{
+    return _ex.twoway_execute(instrument(std::forward<decltype(functor)>(functor)));
+}
+
+inline std::chrono::nanoseconds Latency_histogram::percentile(double q) const {
+    if(!_count) return {};
+    q = std::clamp(q, 0.0, 1.0);
+    // The rank of the value, 1-based
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * _count + 0.5));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < _buckets.size(); ++i) {
+        seen += _buckets[i];
+        if(seen >= rank) return std::chrono::nanoseconds(Buckets::upper_bound(i));
+    }
+    return std::chrono::nanoseconds(Buckets::max_value);
+}
+
+inline void Latency_histogram::record(std::chrono::nanoseconds duration, uint64_t count) {
+    uint64_t value = duration.count() > 0 ? duration.count() : 0;
+    _buckets[Buckets::index_of(value)] += count;
+    _count += count;
+}
+
+inline void Latency_histogram::merge(const Latency_histogram &other) {
+    for(size_t i = 0; i < _buckets.size(); ++i) {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+}
+
+inline void Latency_histogram::merge(const impl::Atomic_histogram &other) {
+    for(size_t i = 0; i < _buckets.size(); ++i) {
+        auto count = other._buckets[i].load(std::memory_order_relaxed);
+        _buckets[i] += count;
+        _count += count;
+    }
+}
+
+inline Task_recorder::Task_recorder(size_t shards)
+    : _shards(std::make_unique<Shard[]>(std::max<size_t>(shards, 1))),
+      _shards_size(std::max<size_t>(shards, 1)) {}
+
+inline void Task_recorder::record_queue_wait(std::chrono::nanoseconds duration) noexcept {
+    this_thread_shard()._queue_wait.record(duration.count() > 0 ? duration.count() : 0);
+}
+
+inline void Task_recorder::record_run_time(std::chrono::nanoseconds duration) noexcept {
+    this_thread_shard()._run_time.record(duration.count() > 0 ? duration.count() : 0);
+}
+
+inline Latency_histogram Task_recorder::queue_wait() const {
+    Latency_histogram histogram;
+    for(size_t i = 0; i < _shards_size; ++i) {
+        histogram.merge(_shards[i]._queue_wait);
+    }
+    return histogram;
+}
+
+inline Latency_histogram Task_recorder::run_time() const {
+    Latency_histogram histogram;
+    for(size_t i = 0; i < _shards_size; ++i) {
+        histogram.merge(_shards[i]._run_time);
+    }
+    return histogram;
+}
+
+inline void Task_recorder::reset() noexcept {
+    for(size_t i = 0; i < _shards_size; ++i) {
+        for(auto &bucket : _shards[i]._queue_wait._buckets) bucket.store(0, std::memory_order_relaxed);
+        for(auto &bucket : _shards[i]._run_time._buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+inline auto Task_recorder::this_thread_shard() noexcept -> Shard& {
+    // Shared by all recorders, threads are spread over shards round-robin
+    static std::atomic<size_t> sequence {0};
+    static thread_local size_t index = sequence.fetch_add(1, std::memory_order_relaxed);
+    return _shards[index % _shards_size];
+}
+
+} // namespace bsio
@@ -0,0 +1,67 @@
+#pragma once
+#include <utility>
+#include <type_traits>
+#include "impl/senders_impl.hpp"
+namespace bsio {
+
+// Senders over any oneway executor
+//
+//     auto work = bsio::when_all(
+//         bsio::schedule(ex) | bsio::then([] { return 1; }),
+//         bsio::schedule(ex) | bsio::then([] { return 2; }));
+//     auto [a, b] = bsio::sync_wait(std::move(work));
+//
+// Operation states are nested by value and connected in place,
+// with Static_thread_pool the whole chain above performs no allocation
+// Errors are std::exception_ptr, there is no stop channel
+
+// A sender completed in the execution context of ex
+// `co_await bsio::schedule(ex)` is also supported
+template <typename Executor>
+inline auto schedule(Executor &&ex) {
+    return impl::senders_impl::Schedule_sender<std::decay_t<Executor>>{std::forward<Executor>(ex)};
+}
+
+// Invoke f with the value of sender, in the context that sender completes on
+template <impl::senders_impl::Typed_sender Sender, typename F>
+inline auto then(Sender &&sender, F &&f) {
+    return impl::senders_impl::Then_sender<std::decay_t<Sender>, std::decay_t<F>>{
+        std::forward<Sender>(sender), std::forward<F>(f)};
+}
+
+// sender | bsio::then(f)
+template <typename F>
+inline auto then(F &&f) {
+    return impl::senders_impl::Then_closure<std::decay_t<F>>{std::forward<F>(f)};
+}
+
+// Complete with a tuple of all non-void values (or void),
+// in the context of the last completed sender
+// All senders are completed before an error is forwarded
+template <impl::senders_impl::Typed_sender ...Senders>
+inline auto when_all(Senders &&...senders) {
+    return impl::senders_impl::When_all_sender<std::decay_t<Senders>...>{std::forward<Senders>(senders)...};
+}
+
+// Start sender and block the caller until it completes
+// Return: its value, the stored exception is rethrown if any
+// Note: do not wait on a pool from its own worker threads
+template <impl::senders_impl::Typed_sender Sender>
+inline auto sync_wait(Sender &&sender) {
+    using namespace impl::senders_impl;
+    using T = Value_of<Sender>;
+    Sync_wait_state<T> state;
+    {
+        auto operation = std::decay_t<Sender>(std::forward<Sender>(sender)).connect(Sync_wait_receiver<T>{&state});
+        operation.start();
+        state.wait();
+    }
+    if(auto exception = std::get_if<2>(&state._result)) {
+        std::rethrow_exception(*exception);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*std::get<1>(state._result));
+    }
+}
+
+} // namespace bsio
@@ -1,25 +1,89 @@
 #pragma once
 #include <cassert>
+#include <atomic>
 #include <memory>
+#include <bit>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include <utility>
 #include <mutex>
 #include <vector>
+#include <string>
+#include <ranges>
 #include <thread>
 #include <functional>
+#include <variant>
+#include <optional>
+#include <coroutine>
 #include <future>
-#include <condition_variable>
 #include "Directionality.hpp"
 #include "Blocking.hpp"
 #include "Relationship.hpp"
 #include "Mapping.hpp"
+#include "Outstanding_work.hpp"
+#include "Future.hpp"
 #include "impl/Functions.hpp"
+#include "impl/Work_stealing_deque.hpp"
+#include "impl/Injection_queue.hpp"
+#include "impl/Backoff.hpp"
+#include "impl/Futex.hpp"
+#include "impl/Timer_wheel.hpp"
+#include "impl/Cpu_topology.hpp"
+#include "impl/Pool_stats.hpp"
+#include "impl/Trace_buffer.hpp"
 namespace bsio {
 
 // 1.6.3
 class Static_thread_pool {
 public:
+    // What an idle thread does before it is parked
+    struct Idle_policy {
+        // Rounds of busy polling with pause instructions
+        size_t spin_rounds;
+        // Rounds of polling with std::this_thread::yield()
+        size_t yield_rounds;
+    };
+
+    static constexpr Idle_policy default_idle_policy {.spin_rounds = 64, .yield_rounds = 4};
+
+    // Where the workers run
+    struct Affinity_policy {
+        // Pin each worker to one CPU
+        bool pin_threads;
+        // Group workers and injection queues by NUMA nodes (/sys/devices/system/node),
+        // and steal from the same node first
+        bool numa_aware;
+        // Allowed CPU ids, empty: all CPUs of this process
+        std::vector<unsigned> cpus;
+    };
+
+    // Number of workers between [min_threads, max_threads]
+    struct Elastic_policy {
+        size_t min_threads;
+        size_t max_threads;
+        // Idle workers above min_threads retire after it
+        std::chrono::milliseconds keep_alive;
+        // A worker is added if nodes are queued, but none is dispatched within it
+        // e.g. all workers are blocked on I/O
+        std::chrono::milliseconds spawn_threshold;
+    };
+
     // Start to execute
     explicit Static_thread_pool(size_t threads);
 
+    Static_thread_pool(size_t threads, Idle_policy idle_policy);
+
+    // Workers are spread over NUMA nodes round-robin
+    Static_thread_pool(size_t threads, const Affinity_policy &affinity_policy,
+                       Idle_policy idle_policy = default_idle_policy);
+
+    // Start with min_threads workers
+    // Note: no worker is added after wait() is called
+    Static_thread_pool(const Elastic_policy &elastic_policy,
+                       const Affinity_policy &affinity_policy = {},
+                       Idle_policy idle_policy = default_idle_policy);
+
     // Stop and wait for completion
     ~Static_thread_pool();
 
@@ -34,6 +98,7 @@ public:
     template <execution::Directionality_property Directionality,
               execution::Blocking_property Blocking,
               execution::Relationship_property Relationship,
+              execution::Outstanding_work_property Outstanding_work,
               typename Allocator>
     class Executor_impl;
 
@@ -41,8 +106,18 @@ public:
         execution::Directionality::Oneway,
         execution::Blocking::Possibly,
         execution::Relationship::Fork,
+        execution::Outstanding_work::Untracked,
         std::allocator<void>>;
 
+    // Awaitables of Directionality::Co_await executors
+    // The awaiter (in the coroutine frame) is the queue node,
+    // so a co_await performs no allocation
+    // Note: a coroutine is never resumed if its node is dropped by stop()
+    class Schedule_awaitable;
+
+    template <typename F>
+    class Twoway_awaitable;
+
 // Core functions
 public:
 
@@ -50,25 +125,123 @@ public:
     Executor_type executor();
 
     // TODO allocator concept
+    // Blocking::Always: the caller runs queued nodes until func is done, func itself may be one of them,
+    // so Mapping::Thread means a pool thread or the calling thread
+    // Throw: std::future_error (broken_promise) if the pool is stopped before func is started
     void execute(execution::Blocking_property auto,
                  execution::Relationship_property auto,
                  const auto &alloc,
                  std::invocable auto func);
 
+    // Continuations of the returned future are deferred to this pool
     auto twoway_execute(execution::Blocking_property auto,
                         execution::Relationship_property auto,
                         const auto &alloc,
                         std::invocable auto func)
-        -> std::future<typename impl::Function_traits<decltype(func)>::Return_type>;
-
+        -> Future<typename impl::Function_traits<decltype(func)>::Return_type>;
+
+    // Invoke func(i) for each i in [0, shape)
+    // Indices are claimed in chunks by at most one descriptor per worker
+    void bulk_execute(execution::Blocking_property auto,
+                      execution::Relationship_property auto,
+                      const auto &alloc,
+                      std::invocable<size_t> auto func,
+                      size_t shape);
+
+    // Submit every callable object in the range at once
+    // Nodes are chained first, then published with a single atomic operation
+    // Note: elements are moved from if the range is an rvalue
+    template <std::ranges::input_range Callables>
+        requires std::invocable<std::ranges::range_value_t<Callables>&>
+    void execute_batch(execution::Blocking_property auto,
+                       execution::Relationship_property auto,
+                       const auto &alloc,
+                       Callables &&callables);
+
+    // Invoke func at (or after) the deadline
+    // Timers never block the caller, idle workers sleep until the nearest one
+    // Note: wait() also waits for pending timers
+    template <typename Clock, typename Duration>
+    void execute_at(const std::chrono::time_point<Clock, Duration> &deadline,
+                    const auto &alloc,
+                    std::invocable auto func);
+
+    template <typename Rep, typename Period>
+    void execute_after(const std::chrono::duration<Rep, Period> &delay,
+                       const auto &alloc,
+                       std::invocable auto func);
+
+    // Attach the calling thread to the pool
+    // Note: an attached thread has no private deque
     void attach();
 
+    // Run a queued node (or an expired timer) on the calling thread
+    // Return: false if nothing is found, or stopped
+    bool run_one();
+
+    // Run queued nodes on the calling thread until pred() is true
+    // The caller sleeps if nothing is found, and is woken up by new nodes
+    // or completion of Blocking::Always executions
+    // Note: pred() changed by other threads is rechecked at least every helper_park_timeout
+    // Return: false if stopped before pred() is true
+    bool run_until(std::predicate auto pred);
+
     // Force stop
     void stop();
 
     // Wait for completion
+    // The caller runs queued nodes until all of them are done
     void wait();
 
+#if defined(BSIO_POOL_STATS)
+// Statistics
+public:
+    // Counters since the worker slot is first used
+    struct Worker_stats {
+        bool alive;
+        int cpu;
+        uint64_t tasks;
+        // Taken from other workers, and from injection queues
+        uint64_t steals;
+        uint64_t injected;
+        uint64_t parks;
+        // Parks ended by a wakeup, not a timeout
+        uint64_t wakeups;
+        // Updated after each run of consecutive nodes, a running node is not counted yet
+        std::chrono::nanoseconds busy;
+        std::chrono::nanoseconds idle;
+        // Private deque, may be stale
+        size_t queue_depth;
+        // Enqueue-to-start latency, latency_sum / tasks for the mean
+        std::chrono::nanoseconds latency_sum;
+        std::chrono::nanoseconds latency_max;
+    };
+
+    // Shared by all non-worker threads running nodes:
+    // wait(), run_until(), run_one() and attached threads
+    struct External_stats {
+        uint64_t tasks;
+        std::chrono::nanoseconds busy;
+        std::chrono::nanoseconds latency_sum;
+        std::chrono::nanoseconds latency_max;
+    };
+
+    struct Stats {
+        size_t active_workers;
+        size_t sleepers;
+        // Non-empty injection queues, may be stale
+        size_t pending_injection_queues;
+        // Outstanding work, including pending timers
+        size_t outstanding_work;
+        std::vector<Worker_stats> workers;
+        External_stats external;
+    };
+
+    // Relaxed reads, the pool is never stopped or locked
+    // Note: only available if BSIO_POOL_STATS is defined
+    Stats stats() const;
+#endif
+
 // Submitted functions
 private:
     using Function_signature = impl::Function_signature;
@@ -88,21 +261,213 @@ private:
     // Access functions
     using Function_node_access = impl::Function_node_access;
 
+    // Shared queue for submissions from non-worker threads
+    using Injection_queue = impl::Injection_queue;
+
+// Futures
+private:
+
+    impl::Future_scheduler future_scheduler() { return {this, &submit_continuation}; }
+
+    // Deferred (Relationship::Continuation), it runs next if submitted by a worker
+    // Note: dropped after stop()
+    static void submit_continuation(void *pool, impl::Function func);
+
 // Thread local
 private:
 
     struct This_thread_private_data;
 
+// Batch
+private:
+
+    // Publish a chain of n nodes [first, ... , last]
+    void submit_chain(Function_node_handle first, Function_node *last, size_t n);
+
+// Timers
+private:
+
+    using Timer_clock = std::chrono::steady_clock;
+
+    // Resolution of the timer wheel
+    using Timer_tick = std::chrono::milliseconds;
+
+    using Timer_wheel = impl::Timer_wheel;
+
+    using Timer_node = impl::Timer_node;
+
+    using Timer_node_handle = impl::Timer_node_handle;
+
+    // Rounded up, never expires early
+    uint64_t timer_ticks_ceil(Timer_clock::time_point time_point) const;
+
+    uint64_t timer_ticks_floor(Timer_clock::time_point time_point) const;
+
+    Timer_clock::time_point timer_time_point(uint64_t ticks) const;
+
+    // Submit expired timers, called by workers between nodes
+    void poll_timers();
+
+// Bulk
+private:
+
+    // Index space shared by bulk descriptors
+    template <typename F, typename Allocator>
+    struct Bulk_state;
+
+// Work stealing
+private:
+
+    // Per-worker data, owned by the pool
+    struct Worker;
+
+    void attach_worker(Worker *worker);
+
+    // Nodes of a continuation chain run back-to-back, then the next one is queued,
+    // so a self-deferring node never starves timers, queued nodes and stop()
+    static constexpr size_t max_chain_length = 64;
+
+    // Take a node from private deque, injection queues, or other workers
+    // Return: nullptr if nothing found
+    Function_node_handle take(Worker *worker);
+
+    // A worker detaches a whole queue and keeps the rest in its deque,
+    // other threads pop a single node
+    Function_node_handle take_injected(Worker *worker);
+
+    Function_node_handle steal(Worker *worker);
+
+    // Each submitter thread sticks to one injection queue of its node
+    Injection_queue& this_thread_injection_queue();
+
+    // Index of the NUMA node (of the pool topology) the calling thread runs on
+    size_t this_thread_node() const;
+
+    // Sleep until new nodes may be available
+    // Return: false if the calling thread should exit (or retire)
+    bool park(Worker *worker);
+
+    // Wake up at most `count` parked workers if any
+    // Spinning workers are counted first, they never miss a node
+    void notify_sleeper(size_t count = 1);
+
+    // Wake up all parked workers to recheck the exit condition
+    // (or the timer keeper, see park())
+    void notify_all_sleepers();
+
+    // Leave the spinning state after finding a node
+    void stop_spinning();
+
+// Caller-runs
+private:
+
+    // Wake up all callers sleeping in run_until()
+    void wake_helpers();
+
+    // Shared by a Blocking::Always caller and its nodes,
+    // the caller may leave a stopped pool before they are run or dropped
+    struct Blocking_state;
+
+    // Caller-runs until all nodes of the state are finished
+    // Throw: std::future_error (broken_promise) if stopped before some node is started
+    void wait_blocking(Blocking_state *state);
+
+    // Bounded, pred() of run_until() may be changed without a wakeup
+    static constexpr std::chrono::milliseconds helper_park_timeout {1};
+
+    // Held while nodes are taken out of the queues, but neither queued again nor finished
+    // No worker exits in wait() meanwhile, they may submit more, see park()
+    class Detached_guard;
+
+// Outstanding work
+private:
+
+    // Pool pointer of tracked executors
+    class Tracked_pointer;
+
+    void on_work_started(size_t count = 1) noexcept;
+    void on_work_finished(size_t count = 1) noexcept;
+
+    bool pending_hint() const;
+
+// Elastic
+private:
+
+    bool is_elastic() const { return _elastic_policy.min_threads < _elastic_policy.max_threads; }
+
+    // Start a thread for a worker slot
+    void start_worker(Worker *worker);
+
+    // Start a worker in a free slot
+    // Return: false if the pool is full or joining
+    bool spawn_worker();
+
+    // Elastic pool only, added a worker if no queued node is dispatched within spawn_threshold,
+    // or at once if nodes are queued to a pool without active workers
+    void supervise();
+
+    void wake_supervisor();
+
+    // Return: false if min_threads is reached
+    bool retire_worker();
+
+    uint64_t dispatched() const;
+
+    // Slots in use, never shrinks
+    size_t workers_used() const { return _workers_used.load(std::memory_order_acquire); }
+
 private:
     std::mutex _mutex;
-    std::condition_variable _cv;
-    std::vector<std::thread> _threads;
-    bool _stopped {false};
-    // Running counter, see attach() for details
-    size_t _running {1};
-    // TODO: multiple shared list_head[N]
-    Function_intrusive_list _list_head;
-    Function_node_access _queue_access [[no_unique_address]];
+    // A slot for each possible worker (max_threads)
+    std::unique_ptr<Worker[]> _workers;
+    size_t _workers_size;
+    Elastic_policy _elastic_policy;
+    // Running workers
+    std::atomic<size_t> _active_workers {0};
+    std::atomic<size_t> _workers_used {0};
+    // Set by the first wait(), no worker is added after it
+    std::atomic<bool> _joining {false};
+    std::thread _supervisor;
+    // The supervisor waits (futex) on it between checks
+    std::atomic<uint32_t> _supervisor_wakeups {0};
+    Idle_policy _idle_policy;
+    std::atomic<bool> _stopped {false};
+    // Running counter, see park() for details
+    std::atomic<size_t> _running {1};
+    // Tracked executors, see park() for details
+    std::atomic<size_t> _outstanding_work {0};
+    // Parked workers, see notify_sleeper() for details
+    std::atomic<size_t> _sleepers {0};
+    // Idle but polling workers, see notify_sleeper() for details
+    std::atomic<size_t> _spinners {0};
+    // Parked workers wait (futex) until it is changed
+    std::atomic<uint32_t> _wakeups {0};
+    // Callers sleeping in run_until()
+    std::atomic<size_t> _helpers {0};
+    std::atomic<uint32_t> _helper_wakeups {0};
+    // Threads holding detached nodes, see Detached_guard
+    std::atomic<size_t> _detached {0};
+    // Nodes run by non-worker threads
+    [[no_unique_address]] impl::External_counters<> _external_stats;
+    // Pending timers are also counted in _outstanding_work
+    std::mutex _timer_mutex;
+    Timer_clock::time_point _timer_epoch {Timer_clock::now()};
+    Timer_wheel _timer_wheel;
+    // Cached _timer_wheel.next_deadline(), a quick check for workers
+    std::atomic<uint64_t> _timer_next {Timer_wheel::never};
+    // At most one parked thread sleeps with a timeout (the keeper)
+    std::atomic<bool> _timer_keeper {false};
+    // When the keeper will wake up
+    std::atomic<uint64_t> _timer_keeper_deadline {Timer_wheel::never};
+    // CPUs of workers, a single node if not NUMA aware
+    impl::Cpu_topology _topology;
+    size_t _nodes_size;
+    // Multiple shared list_head[N], N is a power of two for each node
+    // Submitters are spread over them without a global mutex
+    // [node 0 queues..., node 1 queues..., ...]
+    std::unique_ptr<Injection_queue[]> _injection_queues;
+    size_t _node_injection_mask;
+    size_t _injection_queues_size;
 };
 
 
@@ -110,13 +475,18 @@ private:
 template <execution::Directionality_property Directionality,
           execution::Blocking_property Blocking,
           execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
           typename Allocator>
 class Static_thread_pool::Executor_impl {
     friend class Static_thread_pool;
+    // A tracked executor counts as outstanding work during its lifetime
+    // An untracked one is still trivially copyable
+    using Pool_pointer = std::conditional_t<
+        std::is_same_v<Outstanding_work, execution::Outstanding_work::Tracked>,
+            Tracked_pointer, Static_thread_pool*>;
 public:
     Executor_impl(Static_thread_pool *pool, const Allocator &alloc)
         : _pool(pool), _alloc(alloc) {}
-    ~Executor_impl() = default;
 
     auto operator<=>(const Executor_impl &) const = default;
 
@@ -127,7 +497,7 @@ public:
     // execution::Blocking::Never,
     // execution::Blocking::Always, and
     // execution::Blocking::Possibly
-    constexpr auto require(execution::Blocking_property auto blocking) const { return Executor_impl<Directionality, decltype(blocking), Relationship, Allocator>{_pool, _alloc}; }
+    constexpr auto require(execution::Blocking_property auto blocking) const { return Executor_impl<Directionality, decltype(blocking), Relationship, Outstanding_work, Allocator>{_pool, _alloc}; }
     static constexpr bool query(execution::Blocking_property auto blocking) { return std::is_same_v<Blocking, decltype(blocking)>; }
 
     // TODO
@@ -137,67 +507,339 @@ public:
     // For
     // execution::Relationship::Fork
     // execution::Relationship::Continuation
-    constexpr auto require(execution::Relationship_property auto relationship) const { return Executor_impl<Directionality, Blocking, decltype(relationship), Allocator>{_pool, _alloc}; }
+    constexpr auto require(execution::Relationship_property auto relationship) const { return Executor_impl<Directionality, Blocking, decltype(relationship), Outstanding_work, Allocator>{_pool, _alloc}; }
     static constexpr bool query(execution::Relationship_property auto relationship) { return std::is_same_v<Relationship, decltype(relationship)>; }
 
     // Thread only
-    constexpr auto require(execution::Mapping::Thread) const { return Executor_impl<Directionality, Blocking, Relationship, Allocator>{_pool, _alloc}; }
+    constexpr auto require(execution::Mapping::Thread) const { return Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>{_pool, _alloc}; }
     static constexpr bool query(execution::Mapping_property auto mapping) { return std::is_same_v<execution::Mapping::Thread, decltype(mapping)>; }
 
     // For
     // execution::Directionality::Oneway
     // execution::Directionality::Twoway
-    constexpr auto require(execution::Directionality_property auto directionality) const { return Executor_impl<decltype(directionality), Blocking, Relationship, Allocator>{_pool, _alloc}; }
+    // execution::Directionality::Then
+    constexpr auto require(execution::Directionality_property auto directionality) const { return Executor_impl<decltype(directionality), Blocking, Relationship, Outstanding_work, Allocator>{_pool, _alloc}; }
     static constexpr bool query(execution::Directionality_property auto directionality) { return std::is_same_v<Directionality, decltype(directionality)>; }
 
     // For execution context
     Static_thread_pool* query(execution::Context) { return _pool; }
     const Static_thread_pool* query(execution::Context) const { return _pool; }
 
+    // For
+    // execution::Outstanding_work::Tracked
+    // execution::Outstanding_work::Untracked
+    constexpr auto require(execution::Outstanding_work_property auto outstanding_work) const { return Executor_impl<Directionality, Blocking, Relationship, decltype(outstanding_work), Allocator>{_pool, _alloc}; }
+    static constexpr bool query(execution::Outstanding_work_property auto outstanding_work) { return std::is_same_v<Outstanding_work, decltype(outstanding_work)>; }
+
     constexpr auto prefer(auto any_property) const { return require(any_property); }
 
-    // TODO bulk / allocator / tracking
+    // TODO allocator
 
 
 public:
     void execute(std::invocable auto &&functor)
         requires std::same_as<Directionality, execution::Directionality::Oneway>;
 
-    // Return: std::future<T>
+    // functor(i) for each i in [0, shape)
+    void bulk_execute(std::invocable<size_t> auto &&functor, size_t shape)
+        requires std::same_as<Directionality, execution::Directionality::Oneway>;
+
+    // execute() for each callable object in the range
+    template <std::ranges::input_range Callables>
+        requires std::invocable<std::ranges::range_value_t<Callables>&>
+    void execute_batch(Callables &&callables)
+        requires std::same_as<Directionality, execution::Directionality::Oneway>;
+
+    // Return: Future<T>
     auto twoway_execute(std::invocable auto &&functor)
-        -> std::future<typename impl::Function_traits<decltype(functor)>::Return_type>
+        -> Future<typename impl::Function_traits<decltype(functor)>::Return_type>
         requires std::same_as<Directionality, execution::Directionality::Twoway>;
 
+    // execute() for Polymorphic_executor, the callable is constructed in the node directly
+    void execute_emplace(impl::Function_emplacer emplacer)
+        requires std::same_as<Directionality, execution::Directionality::Oneway>;
+
+    // No allocation: `storage` is the node, it must live until `call` is invoked
+    // Blocking and relationship are ignored, see Senders.hpp
+    void execute_embedded(impl::Function_node_storage &storage, impl::Embedded_call call) const
+        requires std::same_as<Directionality, execution::Directionality::Oneway>;
+
+    // co_await ex.schedule(): resume the coroutine on a pool thread
+    Schedule_awaitable schedule() const
+        requires std::same_as<Directionality, execution::Directionality::Co_await>;
+
+    // co_await ex.twoway_execute(f): invoke f on a pool thread, resume there with its result
+    auto twoway_execute(std::invocable auto &&functor)
+        -> Twoway_awaitable<std::decay_t<decltype(functor)>>
+        requires std::same_as<Directionality, execution::Directionality::Co_await>;
+
+    // Return: Future<T>
+    // Continuations of the returned future are deferred to the private queue,
+    // chained stages run back-to-back on one worker
+    auto then_execute(std::invocable auto &&functor)
+        -> Future<typename impl::Function_traits<decltype(functor)>::Return_type>
+        requires std::same_as<Directionality, execution::Directionality::Then>;
+
+    // Invoke functor(T&&) (or functor() for void) in this pool after pred is ready
+    template <typename T>
+    auto then_execute(auto &&functor, Future<T> pred)
+        requires std::same_as<Directionality, execution::Directionality::Then>;
+
+    // Delayed execute(), blocking and relationship are ignored
+    template <typename Clock, typename Duration>
+    void execute_at(const std::chrono::time_point<Clock, Duration> &deadline, std::invocable auto &&functor)
+        requires std::same_as<Directionality, execution::Directionality::Oneway>;
+
+    template <typename Rep, typename Period>
+    void execute_after(const std::chrono::duration<Rep, Period> &delay, std::invocable auto &&functor)
+        requires std::same_as<Directionality, execution::Directionality::Oneway>;
+
+private:
+    Pool_pointer _pool;
+    Allocator _alloc [[no_unique_address]];
+};
+
+
+
+class Static_thread_pool::Tracked_pointer {
+public:
+    Tracked_pointer(Static_thread_pool *pool) noexcept: _pool(pool) { if(_pool) _pool->on_work_started(); }
+    Tracked_pointer(const Tracked_pointer &p) noexcept: Tracked_pointer(p._pool) {}
+    Tracked_pointer(Tracked_pointer &&p) noexcept: _pool(std::exchange(p._pool, nullptr)) {}
+    ~Tracked_pointer() { if(_pool) _pool->on_work_finished(); }
+
+    Tracked_pointer& operator=(Tracked_pointer p) noexcept {
+        std::swap(_pool, p._pool);
+        return *this;
+    }
+
+    auto operator<=>(const Tracked_pointer &) const = default;
+
+    operator Static_thread_pool*() const noexcept { return _pool; }
+    Static_thread_pool* operator->() const noexcept { return _pool; }
+
 private:
     Static_thread_pool *_pool;
+};
+
+
+
+template <typename F, typename Allocator>
+struct Static_thread_pool::Bulk_state {
+    using State_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Bulk_state>;
+    using State_traits = std::allocator_traits<State_allocator>;
+
+    // Owner of a reference, released even if func throws or the descriptor is dropped
+    struct Releaser {
+        void operator()(Bulk_state *state) const noexcept { state->release(); }
+    };
+    using Handle = std::unique_ptr<Bulk_state, Releaser>;
+
+    Bulk_state(F func, size_t shape, size_t grain, const Allocator &alloc)
+        : _func(std::move(func)), _shape(shape), _grain(grain), _alloc(alloc) {}
+
+    // With a reference for the submitter
+    static Handle make(F func, size_t shape, size_t grain, const Allocator &alloc);
+
+    // A reference for a descriptor
+    Handle share();
+
+    // Claim and invoke chunks until the index space is exhausted
+    // The last chunk wakes up the waiter
+    // If func throws, unclaimed indices are skipped
+    void run(Static_thread_pool *pool);
+
+    // Count indices as completed
+    void complete(size_t count, Static_thread_pool *pool);
+
+    bool done() const { return _completed.load(std::memory_order_acquire) == _shape; }
+
+    // Wait for all indices to complete
+    void wait();
+
+    // Destroyed by the last owner
+    void release() noexcept;
+
+    F _func;
+    const size_t _shape;
+    const size_t _grain;
+    alignas(64) std::atomic<size_t> _next {0};
+    alignas(64) std::atomic<size_t> _completed {0};
+    std::atomic<size_t> _refs {1};
     Allocator _alloc [[no_unique_address]];
 };
 
 
 
+struct Static_thread_pool::Blocking_state {
+    // Owner of a reference, released even if the node is dropped
+    class Handle;
+
+    // With a reference for the caller
+    static Handle make();
+
+    // A reference for a node
+    Handle share();
+
+    // Invoke func unless abandoned, the last node wakes up the caller
+    void run(Static_thread_pool *pool, auto &func);
+
+    // Called by the caller of a stopped pool, no node is started after it
+    // Started nodes are waited for, they may reference the caller's stack
+    // Return: false if some node is never started
+    bool abandon() noexcept;
+
+    void release() noexcept;
+
+    static constexpr uint32_t abandoned = uint32_t{1} << 31;
+
+    // Nodes not finished yet
+    std::atomic<size_t> _remaining {0};
+    // abandoned | started but unfinished nodes
+    std::atomic<uint32_t> _running {0};
+    std::atomic<size_t> _refs {1};
+};
+
+class Static_thread_pool::Blocking_state::Handle {
+public:
+    explicit Handle(Blocking_state *state) noexcept: _state(state) {}
+    Handle(Handle &&other) noexcept: _state(std::exchange(other._state, nullptr)) {}
+    Handle& operator=(Handle &&) = delete;
+    ~Handle() { if(_state) _state->release(); }
+
+    Blocking_state* get() const noexcept { return _state; }
+    Blocking_state* operator->() const noexcept { return _state; }
+
+private:
+    Blocking_state *_state;
+};
+
+
+
+class Static_thread_pool::Detached_guard {
+public:
+    explicit Detached_guard(Static_thread_pool *pool) noexcept;
+    ~Detached_guard();
+
+    Detached_guard(const Detached_guard &) = delete;
+    Detached_guard& operator=(const Detached_guard &) = delete;
+
+private:
+    Static_thread_pool *_pool;
+};
+
+
+
+struct Static_thread_pool::Worker {
+    ~Worker();
+
+    // Owner: LIFO push/pop
+    // Others: FIFO steal
+    impl::Work_stealing_deque<Function_node> _deque;
+    // Index of its NUMA node
+    size_t _node {0};
+    // -1: not pinned
+    int _cpu {-1};
+    // Nodes invoked, written by the owner only
+    std::atomic<uint64_t> _dispatched {0};
+    // The slot can be reused by a new worker once it is false
+    std::atomic<bool> _alive {false};
+    std::thread _thread;
+    // Empty unless BSIO_POOL_STATS is defined
+    [[no_unique_address]] impl::Worker_counters<> _stats;
+};
+
+
+
+class Static_thread_pool::Schedule_awaitable {
+public:
+    explicit Schedule_awaitable(Static_thread_pool *pool) noexcept: _pool(pool) {}
+
+    // The node is referenced by the pool once suspended
+    Schedule_awaitable(const Schedule_awaitable &) = delete;
+    Schedule_awaitable& operator=(const Schedule_awaitable &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    void await_resume() const noexcept {}
+
+private:
+    Static_thread_pool *_pool;
+    impl::Function_node_storage _node;
+};
+
+
+
+template <typename F>
+class Static_thread_pool::Twoway_awaitable {
+public:
+    using Return_type = std::invoke_result_t<F&>;
+
+    static_assert(!std::is_reference_v<Return_type>, "reference results are not supported");
+
+    Twoway_awaitable(Static_thread_pool *pool, F func)
+        : _pool(pool), _func(std::move(func)) {}
+
+    Twoway_awaitable(const Twoway_awaitable &) = delete;
+    Twoway_awaitable& operator=(const Twoway_awaitable &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    // The stored exception is rethrown if any
+    Return_type await_resume();
+
+private:
+    // Invoked by a pool thread, then the coroutine is resumed on it
+    static void call(void *self);
+
+    using Value = std::conditional_t<std::is_void_v<Return_type>, std::monostate, Return_type>;
+
+    Static_thread_pool *_pool;
+    F _func;
+    std::coroutine_handle<> _handle;
+    std::variant<std::monostate, Value, std::exception_ptr> _result;
+    impl::Function_node_storage _node;
+};
+
+
+
 struct Static_thread_pool::This_thread_private_data {
-    This_thread_private_data(Static_thread_pool *owner);
+    This_thread_private_data(Static_thread_pool *owner, Worker *worker);
 
     ~This_thread_private_data();
 
     static This_thread_private_data*& instance();
 
     // FIFO-push
-    void private_queue_push(auto functor);
+    // The first one goes to the run next slot
+    void private_queue_push(auto functor, const auto &alloc);
 
-    // Note: unlocked
-    void private_queue_detach();
+    // Move the private queue to the worker deque (or an injection queue)
+    // Return: the run next node, nullptr if none
+    // Note: the run next node is not traced as submitted, it may be published later
+    Function_node_handle private_queue_detach();
 
     bool private_queue_empty() const;
 
     Static_thread_pool *_owner;
+    // nullptr if attached by users
+    Worker *_worker;
+
+    // Invoked right after the current node on the same thread,
+    // never published, so no wakeup and no atomic operation is required
+    Function_node_handle _run_next;
 
     Function_node_handle _head;
     // Sentinel-tail pointer
     Function_node_handle *_tail_ptr {&_head};
     // Remove if-statement and make life easier!
     Function_node_handle *_prev_tail_ptr {nullptr};
-    
+    size_t _private_size {0};
+
     This_thread_private_data *_prev_thread_data;
 };
 
@@ -206,27 +848,186 @@ struct Static_thread_pool::This_thread_private_data {
 template <execution::Directionality_property Directionality,
           execution::Blocking_property Blocking,
           execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
           typename Allocator>
-inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Allocator>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
 ::execute(std::invocable auto &&functor)
         requires std::same_as<Directionality, execution::Directionality::Oneway> {
-    return _pool->execute(Blocking{}, Relationship{}, Allocator{}, std::forward<decltype(functor)>(functor));
+    return _pool->execute(Blocking{}, Relationship{}, _alloc, std::forward<decltype(functor)>(functor));
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::bulk_execute(std::invocable<size_t> auto &&functor, size_t shape)
+        requires std::same_as<Directionality, execution::Directionality::Oneway> {
+    return _pool->bulk_execute(Blocking{}, Relationship{}, _alloc, std::forward<decltype(functor)>(functor), shape);
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+template <std::ranges::input_range Callables>
+    requires std::invocable<std::ranges::range_value_t<Callables>&>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::execute_batch(Callables &&callables)
+        requires std::same_as<Directionality, execution::Directionality::Oneway> {
+    return _pool->execute_batch(Blocking{}, Relationship{}, _alloc, std::forward<Callables>(callables));
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::execute_emplace(impl::Function_emplacer emplacer)
+        requires std::same_as<Directionality, execution::Directionality::Oneway> {
+    return _pool->execute(Blocking{}, Relationship{}, _alloc, emplacer);
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::execute_embedded(impl::Function_node_storage &storage, impl::Embedded_call call) const
+        requires std::same_as<Directionality, execution::Directionality::Oneway> {
+    auto node = Function_node::embed(&storage, call);
+    auto last = node.get();
+    _pool->submit_chain(std::move(node), last, 1);
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+inline auto Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::schedule() const -> Schedule_awaitable
+        requires std::same_as<Directionality, execution::Directionality::Co_await> {
+    return Schedule_awaitable{_pool};
 }
 
 template <execution::Directionality_property Directionality,
           execution::Blocking_property Blocking,
           execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
           typename Allocator>
-inline auto Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Allocator>
+inline auto Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
 ::twoway_execute(std::invocable auto &&functor)
-        -> std::future<typename impl::Function_traits<decltype(functor)>::Return_type>
+        -> Twoway_awaitable<std::decay_t<decltype(functor)>>
+        requires std::same_as<Directionality, execution::Directionality::Co_await> {
+    return {_pool, std::forward<decltype(functor)>(functor)};
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+inline auto Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::then_execute(std::invocable auto &&functor)
+        -> Future<typename impl::Function_traits<decltype(functor)>::Return_type>
+        requires std::same_as<Directionality, execution::Directionality::Then> {
+    return _pool->twoway_execute(Blocking{}, Relationship{}, _alloc, std::forward<decltype(functor)>(functor));
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+template <typename T>
+inline auto Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::then_execute(auto &&functor, Future<T> pred)
+        requires std::same_as<Directionality, execution::Directionality::Then> {
+    return pred.then(std::forward<decltype(functor)>(functor), _pool->future_scheduler());
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+inline auto Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::twoway_execute(std::invocable auto &&functor)
+        -> Future<typename impl::Function_traits<decltype(functor)>::Return_type>
         requires std::same_as<Directionality, execution::Directionality::Twoway> {
-    return _pool->twoway_execute(Blocking{}, Relationship{}, Allocator{}, std::forward<decltype(functor)>(functor));
+    return _pool->twoway_execute(Blocking{}, Relationship{}, _alloc, std::forward<decltype(functor)>(functor));
 }
 
-inline Static_thread_pool::Static_thread_pool(size_t threads) {
-    while(threads--) {
-        _threads.emplace_back(&Static_thread_pool::attach, this);
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+template <typename Clock, typename Duration>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::execute_at(const std::chrono::time_point<Clock, Duration> &deadline, std::invocable auto &&functor)
+        requires std::same_as<Directionality, execution::Directionality::Oneway> {
+    return _pool->execute_at(deadline, _alloc, std::forward<decltype(functor)>(functor));
+}
+
+template <execution::Directionality_property Directionality,
+          execution::Blocking_property Blocking,
+          execution::Relationship_property Relationship,
+          execution::Outstanding_work_property Outstanding_work,
+          typename Allocator>
+template <typename Rep, typename Period>
+inline void Static_thread_pool::Executor_impl<Directionality, Blocking, Relationship, Outstanding_work, Allocator>
+::execute_after(const std::chrono::duration<Rep, Period> &delay, std::invocable auto &&functor)
+        requires std::same_as<Directionality, execution::Directionality::Oneway> {
+    return _pool->execute_after(delay, _alloc, std::forward<decltype(functor)>(functor));
+}
+
+inline Static_thread_pool::Static_thread_pool(size_t threads)
+    : Static_thread_pool(threads, default_idle_policy) {}
+
+inline Static_thread_pool::Static_thread_pool(size_t threads, Idle_policy idle_policy)
+    : Static_thread_pool(threads, Affinity_policy{.pin_threads = false, .numa_aware = false, .cpus = {}}, idle_policy) {}
+
+inline Static_thread_pool::Static_thread_pool(size_t threads, const Affinity_policy &affinity_policy, Idle_policy idle_policy)
+    : Static_thread_pool(Elastic_policy{.min_threads = threads, .max_threads = threads,
+                                        .keep_alive = {}, .spawn_threshold = {}},
+                         affinity_policy, idle_policy) {}
+
+inline Static_thread_pool::Static_thread_pool(const Elastic_policy &elastic_policy,
+                                              const Affinity_policy &affinity_policy,
+                                              Idle_policy idle_policy)
+    : _workers(std::make_unique<Worker[]>(std::max(elastic_policy.min_threads, elastic_policy.max_threads))),
+      _workers_size(std::max(elastic_policy.min_threads, elastic_policy.max_threads)),
+      _elastic_policy{elastic_policy.min_threads, _workers_size,
+                      elastic_policy.keep_alive, elastic_policy.spawn_threshold},
+      _idle_policy(idle_policy),
+      _topology(impl::Cpu_topology::detect(affinity_policy.cpus, affinity_policy.numa_aware)),
+      _nodes_size(_topology._nodes.size()),
+      _node_injection_mask(std::bit_ceil(std::max<size_t>((_workers_size + _nodes_size - 1) / _nodes_size, 1)) - 1),
+      _injection_queues_size(_nodes_size * (_node_injection_mask + 1))
+{
+    _injection_queues = std::make_unique<Injection_queue[]>(_injection_queues_size);
+    // Workers read the nodes of each other
+    for(size_t index = 0; index < _workers_size; ++index) {
+        auto &worker = _workers[index];
+        worker._node = index % _nodes_size;
+        auto &node_cpus = _topology._nodes[worker._node];
+        if(affinity_policy.pin_threads && !node_cpus.empty()) {
+            worker._cpu = node_cpus[index / _nodes_size % node_cpus.size()];
+        }
+    }
+    std::lock_guard lock{_mutex};
+    for(size_t index = 0; index < _elastic_policy.min_threads; ++index) {
+        _active_workers.fetch_add(1, std::memory_order_relaxed);
+        start_worker(&_workers[index]);
+    }
+    if(is_elastic()) {
+        _supervisor = std::thread(&Static_thread_pool::supervise, this);
     }
 }
 
@@ -249,8 +1050,6 @@ inline void Static_thread_pool::execute(execution::Blocking_property auto blocki
     constexpr bool is_blocking_possibly = std::is_same_v<Blocking, execution::Blocking::Possibly>;
     constexpr bool is_blocking_always = std::is_same_v<Blocking, execution::Blocking::Always>;
     constexpr bool is_relationship_continuation = std::is_same_v<Relationship, execution::Relationship::Continuation>;
-    [](...){}(alloc); // unused
-
 
     if constexpr (is_blocking_possibly || is_blocking_always) {
         if(auto *private_data = This_thread_private_data::instance()) {
@@ -262,21 +1061,26 @@ inline void Static_thread_pool::execute(execution::Blocking_property auto blocki
     }
 
     if constexpr (is_blocking_always) {
-        // Workaround for promise: “std::function target must be copy-constructible”
-        // May be fixed by using std::move_only_function after C++23
-        auto promise = std::make_shared<std::promise<void>>();
-        std::future<void> future = promise->get_future();
-        auto executor = [this] {
-            auto ex1 = this->executor();
+        // The caller is blocked until completion (or abandonment),
+        // so `func` can live on its stack
+        auto state = Blocking_state::make();
+        state->_remaining.store(1, std::memory_order_relaxed);
+        auto executor = [this, &alloc] {
+            using Allocator = std::decay_t<decltype(alloc)>;
+            Executor_impl<execution::Directionality::Oneway,
+                          execution::Blocking::Possibly,
+                          execution::Relationship::Fork,
+                          execution::Outstanding_work::Untracked,
+                          Allocator> ex1 {this, alloc};
             auto ex2 = ex1.require(execution::blocking.never);
             auto ex3 = ex2.prefer(execution::relationship.continuation);
             return ex3;
         } ();
-        executor.execute([func = std::move(func), _ = std::move(promise)]() mutable {
-            std::invoke(func);
-            // Signal to future automatically
+        executor.execute([this, &func, shared = state->share()] {
+            shared->run(this, func);
         });
-        future.wait();
+        // Caller-runs, it may run `func` itself
+        wait_blocking(state.get());
         return;
     }
 
@@ -284,32 +1088,29 @@ inline void Static_thread_pool::execute(execution::Blocking_property auto blocki
         if(auto *private_data = This_thread_private_data::instance()) {
             if(private_data->_owner == this) {
                 // defer
-                private_data->private_queue_push(std::move(func));
+                private_data->private_queue_push(std::move(func), alloc);
                 return;
             }
         }
     }
 
-    auto new_node = std::make_unique<Function_node>(std::move(func));
+    // Node storage is pooled, only large callable objects use alloc
+    auto new_node = Function_node::make(std::move(func), alloc);
+    impl::trace(impl::Trace_type::submit, new_node.get(), 1);
 
-    bool wake_more = [&] {
-        std::lock_guard lock{_mutex};
-
-        constexpr bool eager_mode = false /*|| is_heavy_task(func)*/;
-        bool wake_more = eager_mode && _list_head._next && _list_head._next->_next;
-
-        _queue_access.push(_list_head, std::move(new_node));
+    // Submitted by a worker, push to its private deque
+    if(auto *private_data = This_thread_private_data::instance()) {
+        if(private_data->_owner == this && private_data->_worker) {
+            private_data->_worker->_deque.push(new_node.release());
+            notify_sleeper();
+            return;
+        }
+    }
 
-        return wake_more;
-    } ();
+    this_thread_injection_queue().push(std::move(new_node));
 
-    // If there are too many pending nodes,
-    // we can try to notify all
-    if(wake_more) {
-        _cv.notify_all();
-    } else {
-        _cv.notify_one();
-    }
+    // No syscall if all workers are awake
+    notify_sleeper();
 }
 
 inline auto Static_thread_pool::twoway_execute(
@@ -317,70 +1118,993 @@ inline auto Static_thread_pool::twoway_execute(
         execution::Relationship_property auto relationship,
         const auto &alloc,
         std::invocable auto func)
--> std::future<typename impl::Function_traits<decltype(func)>::Return_type> {
-    // Workaround again
+-> Future<typename impl::Function_traits<decltype(func)>::Return_type> {
     using Ret = typename impl::Function_traits<decltype(func)>::Return_type;
-    auto promise = std::make_shared<std::promise<Ret>>();
-    auto wrapped_func = [f = std::move(func), promise]() mutable {
-        if constexpr (std::is_same_v<void, Ret>) {
-            std::invoke(f);
+    // impl::Function is move-only, the promise is owned by the node
+    // Both the node and the shared state are pooled
+    Promise<Ret> promise {future_scheduler()};
+    auto future = promise.get_future();
+    auto wrapped_func = [f = std::move(func), promise = std::move(promise)]() mutable {
+        promise.set_value_from(f);
+    };
+    this->execute(blocking, relationship, alloc, std::move(wrapped_func));
+    return future;
+}
+
+inline void Static_thread_pool::Schedule_awaitable::await_suspend(std::coroutine_handle<> handle) {
+    auto node = Function_node::embed(&_node, {
+        [](void *address) { std::coroutine_handle<>::from_address(address).resume(); },
+        handle.address()
+    });
+    auto last = node.get();
+    // `this` may be destroyed once submitted
+    _pool->submit_chain(std::move(node), last, 1);
+}
+
+template <typename F>
+inline void Static_thread_pool::Twoway_awaitable<F>::await_suspend(std::coroutine_handle<> handle) {
+    _handle = handle;
+    auto node = Function_node::embed(&_node, {&call, this});
+    auto last = node.get();
+    // `this` may be destroyed once submitted
+    _pool->submit_chain(std::move(node), last, 1);
+}
+
+template <typename F>
+inline void Static_thread_pool::Twoway_awaitable<F>::call(void *self) {
+    auto awaitable = static_cast<Twoway_awaitable*>(self);
+    try {
+        if constexpr (std::is_void_v<Return_type>) {
+            std::invoke(awaitable->_func);
+            awaitable->_result.template emplace<1>();
         } else {
-            promise->set_value(std::invoke(f));
+            awaitable->_result.template emplace<1>(std::invoke(awaitable->_func));
         }
-        
+    } catch(...) {
+        awaitable->_result.template emplace<2>(std::current_exception());
+    }
+    awaitable->_handle.resume();
+}
+
+template <typename F>
+inline auto Static_thread_pool::Twoway_awaitable<F>::await_resume() -> Return_type {
+    if(auto exception = std::get_if<2>(&_result)) {
+        std::rethrow_exception(*exception);
+    }
+    if constexpr (!std::is_void_v<Return_type>) {
+        return std::move(std::get<1>(_result));
+    }
+}
+
+inline void Static_thread_pool::submit_continuation(void *pool, impl::Function func) {
+    auto self = static_cast<Static_thread_pool*>(pool);
+    // Stopped, or dropping queued nodes in the destructor:
+    // the continuation is dropped here, so a chained promise is broken at once
+    if(self->_stopped.load(std::memory_order_relaxed)) return;
+    self->execute(execution::blocking.never, execution::relationship.continuation,
+                  std::allocator<void>{}, std::move(func));
+}
+
+template <std::ranges::input_range Callables>
+    requires std::invocable<std::ranges::range_value_t<Callables>&>
+inline void Static_thread_pool::execute_batch(execution::Blocking_property auto blocking,
+                                              execution::Relationship_property auto relationship,
+                                              const auto &alloc,
+                                              Callables &&callables)
+{
+    using Blocking = decltype(blocking);
+    using Relationship = decltype(relationship);
+    constexpr bool is_blocking_possibly = std::is_same_v<Blocking, execution::Blocking::Possibly>;
+    constexpr bool is_blocking_always = std::is_same_v<Blocking, execution::Blocking::Always>;
+    constexpr bool is_relationship_continuation = std::is_same_v<Relationship, execution::Relationship::Continuation>;
+    // Elements can be referenced by nodes only if they outlive the batch
+    constexpr bool is_element_lvalue = std::is_lvalue_reference_v<std::ranges::range_reference_t<Callables>>;
+
+    auto *private_data = This_thread_private_data::instance();
+    bool is_owner = private_data && private_data->_owner == this;
+
+    if constexpr (is_blocking_possibly || is_blocking_always) {
+        if(is_owner) {
+            for(auto &&func : callables) {
+                std::invoke(func);
+            }
+            return;
+        }
+    }
+
+    if constexpr (is_relationship_continuation && !is_blocking_always) {
+        if(is_owner) {
+            for(auto &&func : callables) {
+                if constexpr (std::is_lvalue_reference_v<Callables>) {
+                    private_data->private_queue_push(func, alloc);
+                } else {
+                    private_data->private_queue_push(std::move(func), alloc);
+                }
+            }
+            return;
+        }
+    }
+
+    Function_node_handle first;
+    Function_node_handle *tail_ptr = &first;
+    Function_node *last = nullptr;
+    size_t n = 0;
+    auto append = [&](Function_node_handle node) {
+        last = node.get();
+        *tail_ptr = std::move(node);
+        tail_ptr = &last->_next;
+        ++n;
     };
-    this->execute(blocking, relationship, alloc, std::move(wrapped_func));
-    return promise->get_future();
+
+    if constexpr (is_blocking_always) {
+        // The caller is blocked until completion (or abandonment),
+        // only the last finished node wakes it up
+        auto state = Blocking_state::make();
+        for(auto &&func : callables) {
+            if constexpr (is_element_lvalue) {
+                append(Function_node::make([this, &func, shared = state->share()] {
+                    shared->run(this, func);
+                }, alloc));
+            } else {
+                append(Function_node::make([this, func = std::move(func), shared = state->share()]() mutable {
+                    shared->run(this, func);
+                }, alloc));
+            }
+        }
+        if(!n) return;
+        state->_remaining.store(n, std::memory_order_relaxed);
+        submit_chain(std::move(first), last, n);
+        wait_blocking(state.get());
+        return;
+    }
+
+    // Node storage is pooled, only large callable objects use alloc
+    for(auto &&func : callables) {
+        if constexpr (std::is_lvalue_reference_v<Callables>) {
+            append(Function_node::make(func, alloc));
+        } else {
+            append(Function_node::make(std::move(func), alloc));
+        }
+    }
+    submit_chain(std::move(first), last, n);
+}
+
+inline void Static_thread_pool::submit_chain(Function_node_handle first, Function_node *last, size_t n) {
+    if(!n) return;
+    if constexpr (impl::pool_trace_enabled) {
+        // Before publishing, nodes may be run (and released) at once
+        // Each node has its own flow from this submission
+        impl::trace(impl::Trace_type::submit, first.get(), n);
+        for(auto node = first->_next.get(); node; node = node->_next.get()) {
+            impl::trace(impl::Trace_type::submit, node, 0);
+        }
+    }
+    // Submitted by a worker, push to its private deque
+    if(auto *private_data = This_thread_private_data::instance()) {
+        if(private_data->_owner == this && private_data->_worker) {
+            private_data->_worker->_deque.push_chain(first.release(), n,
+                [](Function_node *node) { return node->_next.release(); });
+            notify_sleeper(n);
+            return;
+        }
+    }
+    this_thread_injection_queue().push(std::move(first), last);
+    // Wake up at most min(n, idle) workers
+    notify_sleeper(n);
+}
+
+template <typename Clock, typename Duration>
+inline void Static_thread_pool::execute_at(const std::chrono::time_point<Clock, Duration> &deadline,
+                                           const auto &alloc,
+                                           std::invocable auto func)
+{
+    auto now = Timer_clock::now();
+    Timer_clock::time_point steady_deadline;
+    if constexpr (std::is_same_v<Clock, Timer_clock>) {
+        steady_deadline = std::chrono::time_point_cast<Timer_clock::duration>(deadline);
+    } else {
+        // Other clocks are converted once, adjustments after this call are ignored
+        steady_deadline = now + std::chrono::duration_cast<Timer_clock::duration>(deadline - Clock::now());
+    }
+    uint64_t ticks = timer_ticks_ceil(steady_deadline);
+
+    auto node = Function_node::make(std::move(func), alloc);
+    auto timer = Timer_node::make(std::move(node), ticks);
+    on_work_started();
+    {
+        std::lock_guard lock{_timer_mutex};
+        // Skip the stale time of an idle wheel, so the clamp of long timeouts is exact
+        if(_timer_wheel.empty()) {
+            _timer_wheel.advance(timer_ticks_floor(now), [](Timer_node_handle) {});
+        }
+        if((timer = _timer_wheel.insert(std::move(timer)))) {
+            // Already expired
+            node = std::move(timer->_node);
+        } else {
+            _timer_next.store(_timer_wheel.next_deadline(), std::memory_order_relaxed);
+        }
+    }
+
+    if(node) {
+        auto last = node.get();
+        submit_chain(std::move(node), last, 1);
+        on_work_finished();
+        return;
+    }
+
+    // Pairs with the fence in park()
+    // Either the keeper sees this timer, or we see the keeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t keeper_deadline = _timer_keeper_deadline.load(std::memory_order_relaxed);
+    if(ticks < keeper_deadline) {
+        if(keeper_deadline == Timer_wheel::never) {
+            // No keeper yet, the next parked thread will be
+            notify_sleeper();
+        } else {
+            // The keeper would sleep too long
+            notify_all_sleepers();
+        }
+    }
+}
+
+template <typename Rep, typename Period>
+inline void Static_thread_pool::execute_after(const std::chrono::duration<Rep, Period> &delay,
+                                              const auto &alloc,
+                                              std::invocable auto func)
+{
+    execute_at(Timer_clock::now() + std::chrono::ceil<Timer_clock::duration>(delay), alloc, std::move(func));
+}
+
+inline uint64_t Static_thread_pool::timer_ticks_ceil(Timer_clock::time_point time_point) const {
+    if(time_point <= _timer_epoch) return 0;
+    return std::chrono::ceil<Timer_tick>(time_point - _timer_epoch).count();
+}
+
+inline uint64_t Static_thread_pool::timer_ticks_floor(Timer_clock::time_point time_point) const {
+    if(time_point <= _timer_epoch) return 0;
+    return std::chrono::floor<Timer_tick>(time_point - _timer_epoch).count();
+}
+
+inline auto Static_thread_pool::timer_time_point(uint64_t ticks) const -> Timer_clock::time_point {
+    return _timer_epoch + Timer_tick(ticks);
+}
+
+inline void Static_thread_pool::poll_timers() {
+    uint64_t next = _timer_next.load(std::memory_order_relaxed);
+    if(next == Timer_wheel::never) return;
+    uint64_t now = timer_ticks_floor(Timer_clock::now());
+    if(now < next) return;
+    // Someone else is polling or inserting, retry later
+    std::unique_lock lock{_timer_mutex, std::try_to_lock};
+    if(!lock) return;
+
+    Function_node_handle first;
+    Function_node_handle *tail_ptr = &first;
+    Function_node *last = nullptr;
+    size_t n = 0;
+    _timer_wheel.advance(now, [&](Timer_node_handle timer) {
+        last = timer->_node.get();
+        // Queued from now on
+        last->_enqueued.stamp();
+        *tail_ptr = std::move(timer->_node);
+        tail_ptr = &last->_next;
+        ++n;
+    });
+    _timer_next.store(_timer_wheel.next_deadline(), std::memory_order_relaxed);
+    lock.unlock();
+
+    submit_chain(std::move(first), last, n);
+    // Now counted as queued nodes
+    if(n) on_work_finished(n);
+}
+
+inline void Static_thread_pool::bulk_execute(execution::Blocking_property auto blocking,
+                                             execution::Relationship_property auto relationship,
+                                             const auto &alloc,
+                                             std::invocable<size_t> auto func,
+                                             size_t shape)
+{
+    using Blocking = decltype(blocking);
+    using Allocator = std::decay_t<decltype(alloc)>;
+    using State = Bulk_state<decltype(func), Allocator>;
+    constexpr bool is_blocking_possibly = std::is_same_v<Blocking, execution::Blocking::Possibly>;
+    constexpr bool is_blocking_always = std::is_same_v<Blocking, execution::Blocking::Always>;
+    // Relationship is not used,
+    // all indices of a bulk are forked
+    std::ignore = relationship;
+
+    if(!shape) return;
+
+    // The caller takes part in the execution if it is allowed to block
+    bool participate = is_blocking_always;
+    if constexpr (is_blocking_possibly) {
+        if(auto *private_data = This_thread_private_data::instance()) {
+            participate = private_data->_owner == this;
+        }
+    }
+
+    // About 8 chunks per worker, for load balancing
+    // At least one descriptor is queued for a pool without active workers,
+    // unless the caller runs them all
+    size_t workers = std::max<size_t>(_active_workers.load(std::memory_order_relaxed), 1);
+    size_t grain = std::max<size_t>(1, shape / (workers * 8));
+    size_t chunks = (shape + grain - 1) / grain;
+    size_t descriptors = std::min(workers, participate ? chunks - 1 : chunks);
+
+    auto state = State::make(std::move(func), shape, grain, alloc);
+
+    // One descriptor per worker,
+    // the i-th injection queue is the first one scanned by the i-th worker
+    for(size_t i = 0; i < descriptors; ++i) {
+        auto descriptor = Function_node::make([this, shared = state->share()] {
+            shared->run(this);
+        }, alloc);
+        _injection_queues[i % _injection_queues_size].push(std::move(descriptor));
+    }
+    notify_sleeper(descriptors);
+
+    if(participate) {
+        // Also on exceptions, running chunks may reference the caller's stack
+        // After run(), every chunk is claimed, so it never waits for dropped descriptors
+        struct Waiter {
+            ~Waiter() { state->wait(); }
+            State *state;
+        } waiter {state.get()};
+        state->run(this);
+        // Caller-runs, like other blocking executions
+        run_until([&] { return state->done(); });
+    }
+}
+
+template <typename F, typename Allocator>
+inline auto Static_thread_pool::Bulk_state<F, Allocator>::make(
+        F func, size_t shape, size_t grain, const Allocator &alloc) -> Handle {
+    State_allocator state_alloc {alloc};
+    Bulk_state *state = State_traits::allocate(state_alloc, 1);
+    try {
+        State_traits::construct(state_alloc, state, std::move(func), shape, grain, alloc);
+    } catch(...) {
+        State_traits::deallocate(state_alloc, state, 1);
+        throw;
+    }
+    return Handle{state};
+}
+
+template <typename F, typename Allocator>
+inline auto Static_thread_pool::Bulk_state<F, Allocator>::share() -> Handle {
+    _refs.fetch_add(1, std::memory_order_relaxed);
+    return Handle{this};
+}
+
+template <typename F, typename Allocator>
+inline void Static_thread_pool::Bulk_state<F, Allocator>::run(Static_thread_pool *pool) {
+    for(;;) {
+        size_t first = _next.fetch_add(_grain, std::memory_order_relaxed);
+        if(first >= _shape) return;
+        size_t last = std::min(first + _grain, _shape);
+        size_t index = first;
+        try {
+            for(; index != last; ++index) {
+                std::invoke(_func, index);
+            }
+        } catch(...) {
+            size_t next = _next.exchange(_shape, std::memory_order_relaxed);
+            complete(last - index + (next < _shape ? _shape - next : 0), pool);
+            throw;
+        }
+        complete(last - first, pool);
+    }
+}
+
+template <typename F, typename Allocator>
+inline void Static_thread_pool::Bulk_state<F, Allocator>::complete(size_t count, Static_thread_pool *pool) {
+    if(_completed.fetch_add(count, std::memory_order_acq_rel) + count != _shape) return;
+    // Safe: a waiter still holds a reference
+    _completed.notify_all();
+    // Pairs with the fence in run_until()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(pool->_helpers.load(std::memory_order_relaxed)) pool->wake_helpers();
+}
+
+template <typename F, typename Allocator>
+inline void Static_thread_pool::Bulk_state<F, Allocator>::wait() {
+    for(size_t completed; (completed = _completed.load(std::memory_order_acquire)) != _shape;) {
+        _completed.wait(completed, std::memory_order_acquire);
+    }
+}
+
+template <typename F, typename Allocator>
+inline void Static_thread_pool::Bulk_state<F, Allocator>::release() noexcept {
+    if(_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        State_allocator state_alloc {_alloc};
+        State_traits::destroy(state_alloc, this);
+        State_traits::deallocate(state_alloc, this, 1);
+    }
+}
+
+inline auto Static_thread_pool::Blocking_state::make() -> Handle {
+    using Pool = impl::Node_pool<sizeof(Blocking_state), alignof(Blocking_state)>;
+    void *block = Pool::allocate();
+    return Handle{::new (block) Blocking_state};
+}
+
+inline auto Static_thread_pool::Blocking_state::share() -> Handle {
+    _refs.fetch_add(1, std::memory_order_relaxed);
+    return Handle{this};
+}
+
+inline void Static_thread_pool::Blocking_state::run(Static_thread_pool *pool, auto &func) {
+    uint32_t running = _running.load(std::memory_order_relaxed);
+    do {
+        if(running & abandoned) return;
+    } while(!_running.compare_exchange_weak(running, running + 1,
+                std::memory_order_acquire, std::memory_order_relaxed));
+    std::invoke(func);
+    bool last = _remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    // Only an abandoning caller sleeps on it
+    if(_running.fetch_sub(1, std::memory_order_acq_rel) == (abandoned | 1)) {
+        impl::Futex::wake_all(_running);
+    }
+    if(!last) return;
+    // Pairs with the fence in run_until()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(pool->_helpers.load(std::memory_order_relaxed)) pool->wake_helpers();
+}
+
+inline bool Static_thread_pool::Blocking_state::abandon() noexcept {
+    uint32_t running = _running.fetch_or(abandoned, std::memory_order_acq_rel) | abandoned;
+    for(; running != abandoned; running = _running.load(std::memory_order_acquire)) {
+        impl::Futex::wait(_running, running);
+    }
+    return !_remaining.load(std::memory_order_acquire);
+}
+
+inline void Static_thread_pool::Blocking_state::release() noexcept {
+    if(_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    using Pool = impl::Node_pool<sizeof(Blocking_state), alignof(Blocking_state)>;
+    this->~Blocking_state();
+    Pool::deallocate(this);
+}
+
+inline void Static_thread_pool::wait_blocking(Blocking_state *state) {
+    if(run_until([state] { return !state->_remaining.load(std::memory_order_acquire); })) return;
+    // Stopped, queued nodes may be dropped (or never taken)
+    if(!state->abandon()) {
+        throw std::future_error(std::future_errc::broken_promise);
+    }
 }
 
 inline void Static_thread_pool::attach() {
-    This_thread_private_data private_data {this};
-    for(std::unique_lock lock{_mutex}; ; private_data.private_queue_detach()) {
-        // _stopped flag: force stop, if anyone send this message
+    attach_worker(nullptr);
+}
+
+inline void Static_thread_pool::attach_worker(Worker *worker) {
+    This_thread_private_data private_data {this, worker};
+    if constexpr (impl::pool_trace_enabled) {
+        impl::Trace_registry::instance().name_this_thread(worker
+            ? "bsio worker " + std::to_string(worker - &_workers[0])
+            : "bsio attached");
+    }
+    impl::Backoff backoff {_idle_policy.spin_rounds, _idle_policy.yield_rounds};
+    // Always 0 if stats are disabled
+    uint64_t idle_since = impl::stats_now();
+    // _stopped flag: force stop, if anyone send this message
+    while(!_stopped.load(std::memory_order_relaxed)) {
+        poll_timers();
+        // A block scope for resource management
+        if(auto node = take(worker)) {
+            if(backoff.waiting()) {
+                backoff.reset();
+                stop_spinning();
+            }
+            uint64_t busy_since = impl::stats_now();
+            uint64_t now = busy_since;
+            size_t chain_length = 0;
+            do {
+                if(worker) {
+                    worker->_dispatched.store(worker->_dispatched.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+                    worker->_stats.on_started(now - node->_enqueued.time());
+                } else {
+                    _external_stats.on_started(now - node->_enqueued.time());
+                }
+                auto id = node.get();
+                impl::trace(impl::Trace_type::start, id);
+                // Optimization: release the resource eagerly
+                Function_node::run(std::move(node));
+                impl::trace(impl::Trace_type::end, id);
+                // Keep a continuation chain on this thread with a hot cache
+                node = private_data.private_queue_detach();
+                now = impl::stats_now();
+                if(node && (++chain_length == max_chain_length || _stopped.load(std::memory_order_relaxed))) {
+                    auto last = node.get();
+                    submit_chain(std::move(node), last, 1);
+                } else if(node) {
+                    // Traced once, submit_chain() traces a published one
+                    impl::trace(impl::Trace_type::submit, node.get(), 1);
+                }
+            } while(node);
+            if(worker) {
+                worker->_stats.on_idle(busy_since - idle_since);
+                worker->_stats.on_busy(now - busy_since);
+            } else {
+                _external_stats.on_busy(now - busy_since);
+            }
+            idle_since = now;
+            continue;
+        }
+        // Spin -> yield -> park
+        // Producers skip the wakeup while anyone is spinning
+        if(!backoff.waiting()) {
+            _spinners.fetch_add(1, std::memory_order_relaxed);
+        }
+        if(backoff.pause()) continue;
+        backoff.reset();
+        _spinners.fetch_sub(1, std::memory_order_relaxed);
+        if(!park(worker)) return;
+    }
+    if(backoff.waiting()) {
+        _spinners.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+inline auto Static_thread_pool::take(Worker *worker) -> Function_node_handle {
+    if(worker) {
+        if(auto node = worker->_deque.pop()) {
+            return Function_node_handle{node};
+        }
+    }
+    if(auto node = take_injected(worker)) {
+        return node;
+    }
+    return steal(worker);
+}
+
+inline auto Static_thread_pool::take_injected(Worker *worker) -> Function_node_handle {
+    size_t start = worker ? worker - &_workers[0] : 0;
+    size_t node = worker ? worker->_node : this_thread_node();
+    size_t group_size = _node_injection_mask + 1;
+    // Queues of the same node first
+    for(size_t i = 0; i < _injection_queues_size; ++i) {
+        size_t group = (node + i / group_size) % _nodes_size;
+        auto &queue = _injection_queues[group * group_size + ((start + i) & _node_injection_mask)];
+        // Attached by users, no private deque to keep the rest
+        if(!worker) {
+            if(auto node = queue.pop()) return node;
+            continue;
+        }
+        if(queue.empty_hint()) continue;
+        Detached_guard guard {this};
+        auto node = queue.consume_all();
+        if(!node) continue;
+        worker->_stats.on_injected(1);
+        // Run the newest one, and keep the rest in private deque
+        if(auto rest = std::move(node->_next)) {
+            // Oldest one will be popped first
+            while(rest) {
+                auto next = std::move(rest->_next);
+                worker->_deque.push(rest.release());
+                worker->_stats.on_injected(1);
+                rest = std::move(next);
+            }
+            notify_sleeper();
+        }
+        return node;
+    }
+    return nullptr;
+}
+
+inline auto Static_thread_pool::steal(Worker *worker) -> Function_node_handle {
+    // Start from the next sibling to spread stealers
+    size_t start = worker ? worker - &_workers[0] + 1 : 0;
+    size_t node = worker ? worker->_node : this_thread_node();
+    // Same node first, a cross-node steal moves the node and its captures between sockets
+    for(size_t pass = 0, passes = _nodes_size > 1 ? 2 : 1; pass < passes; ++pass) {
+        for(size_t i = 0, used = workers_used(); i < used; ++i) {
+            auto &victim = _workers[(start + i) % used];
+            if(&victim == worker) continue;
+            if(passes > 1 && (victim._node == node) != (pass == 0)) continue;
+            if(auto stolen = victim._deque.steal()) {
+                if(worker) worker->_stats.on_stolen();
+                impl::trace(impl::Trace_type::steal, stolen, static_cast<uint32_t>(&victim - &_workers[0]));
+                return Function_node_handle{stolen};
+            }
+        }
+    }
+    return nullptr;
+}
+
+inline bool Static_thread_pool::park(Worker *worker) {
+    if(worker) worker->_stats.on_parked();
+    impl::trace(impl::Trace_type::park);
+    // Pairs with the fence in notify_sleeper()
+    // Either the producer sees this sleeper, or we see its node
+    _sleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Any wakeup after this point changes the value,
+    // and the state changed before it is visible (release-acquire)
+    auto wakeups = _wakeups.load(std::memory_order_acquire);
+    // The keeper sleeps until the nearest deadline,
+    // it is woken up by execute_at() if a new timer is earlier
+    bool is_keeper = _timer_next.load(std::memory_order_relaxed) != Timer_wheel::never
+        && !_timer_keeper.exchange(true, std::memory_order_acquire);
+    uint64_t deadline = Timer_wheel::never;
+    if(is_keeper) {
+        std::lock_guard lock{_timer_mutex};
+        deadline = _timer_wheel.next_deadline();
+        _timer_keeper_deadline.store(deadline, std::memory_order_relaxed);
+    }
+    // Elastic workers above min_threads retire after keep_alive
+    bool may_retire = worker && is_elastic()
+        && _active_workers.load(std::memory_order_relaxed) > _elastic_policy.min_threads;
+    auto retire_time_point = Timer_clock::now() + _elastic_policy.keep_alive;
+    bool retired = false;
+    bool keep_running = [&] {
+        if(_stopped.load(std::memory_order_relaxed)) return false;
+        if(pending_hint()) return true;
+        if(deadline != Timer_wheel::never
+                && timer_ticks_floor(Timer_clock::now()) >= deadline) return true;
         // _running counter: threads will not sleep when users are ALL wait-ing()
-        _cv.wait(lock, [&] { return _stopped || 0 == _running || !_queue_access.empty(_list_head); });
-        if(_stopped) return;
         // If users are all wait()-ing but tasks are queueing,
         // we should first complete all the tasks
-        if(!_running && _queue_access.empty(_list_head)) return;
-        assert(!_queue_access.empty(_list_head));
+        // Tracked executors may still submit tasks, keep parking until they are gone
+        // So may detached nodes, keep parking until the last Detached_guard wakes us up
+        if(!_running.load(std::memory_order_relaxed)
+                && !_outstanding_work.load(std::memory_order_relaxed)) {
+            // Pairs with the fence in Detached_guard
+            // A node detached from a queue seen empty is counted here
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(!_detached.load(std::memory_order_acquire)) return pending_hint();
+        }
+        if(deadline == Timer_wheel::never && !may_retire) {
+            impl::Futex::wait(_wakeups, wakeups);
+            if(worker && _wakeups.load(std::memory_order_relaxed) != wakeups) worker->_stats.on_woken();
+            return true;
+        }
+        auto wake_time_point = may_retire ? retire_time_point : Timer_clock::time_point::max();
+        if(deadline != Timer_wheel::never) {
+            wake_time_point = std::min(wake_time_point, timer_time_point(deadline));
+        }
+        impl::Futex::wait_until(_wakeups, wakeups, wake_time_point);
+        if(worker && _wakeups.load(std::memory_order_relaxed) != wakeups) worker->_stats.on_woken();
+        // Timed out without any wakeup and new nodes
+        // Note: nodes may be pushed without a wakeup (spinners), so recheck them
+        retired = may_retire && Timer_clock::now() >= retire_time_point
+            && _wakeups.load(std::memory_order_acquire) == wakeups
+            && !pending_hint() && retire_worker();
+        return !retired;
+    } ();
+    _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    impl::trace(impl::Trace_type::wake, nullptr, _wakeups.load(std::memory_order_relaxed) != wakeups);
+    if(retired) {
+        // Pairs with the fence in notify_sleeper()
+        // A producer that counted this sleeper woke no one, so check its node here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(!_active_workers.load(std::memory_order_relaxed) && pending_hint()) wake_supervisor();
+    }
+    if(is_keeper) {
+        _timer_keeper_deadline.store(Timer_wheel::never, std::memory_order_relaxed);
+        _timer_keeper.store(false, std::memory_order_release);
+        // Woken up early for new nodes, hand the timers over to another parked thread
+        // Or retired before the deadline
+        if((keep_running || retired) && timer_ticks_floor(Timer_clock::now()) < deadline) {
+            notify_sleeper();
+        }
+    }
+    return keep_running;
+}
 
-        // A block scope for resource management
-        {
-            auto node = _queue_access.consume_one(_list_head);
-            // `node` has been detached from shared queue
-            lock.unlock();
-            std::invoke(node->_func);
-            // Optimization: release the resource eagerly
-            // This avoid RAII after lock() is acquired
+inline auto Static_thread_pool::this_thread_injection_queue() -> Injection_queue& {
+    static std::atomic<size_t> sequence {0};
+    static thread_local size_t index = sequence.fetch_add(1, std::memory_order_relaxed);
+    size_t group = this_thread_node();
+    return _injection_queues[group * (_node_injection_mask + 1) + (index & _node_injection_mask)];
+}
+
+inline size_t Static_thread_pool::this_thread_node() const {
+    if(_nodes_size == 1) return 0;
+    if(auto *private_data = This_thread_private_data::instance()) {
+        if(private_data->_owner == this && private_data->_worker) {
+            return private_data->_worker->_node;
         }
+    }
+    return _topology.node_of(impl::this_thread_cpu());
+}
 
-        lock.lock();
+inline void Static_thread_pool::notify_sleeper(size_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Blocked callers help regardless of spinners
+    if(_helpers.load(std::memory_order_relaxed)) wake_helpers();
+    // A spinner either takes the node,
+    // or sees it in park() since it leaves spinning before the fence there
+    size_t spinners = _spinners.load(std::memory_order_relaxed);
+    if(count <= spinners) return;
+    count -= spinners;
+    if(size_t sleepers = _sleepers.load(std::memory_order_relaxed)) {
+        _wakeups.fetch_add(1, std::memory_order_release);
+        if(count >= sleepers) {
+            impl::Futex::wake_all(_wakeups);
+        } else {
+            impl::Futex::wake(_wakeups, static_cast<int>(count));
+        }
+    } else if(is_elastic() && !_active_workers.load(std::memory_order_relaxed)) {
+        // All workers are retired, see also park()
+        wake_supervisor();
     }
 }
 
-inline void Static_thread_pool::stop() {
+inline void Static_thread_pool::notify_all_sleepers() {
+    _wakeups.fetch_add(1, std::memory_order_release);
+    impl::Futex::wake_all(_wakeups);
+}
+
+inline void Static_thread_pool::wake_helpers() {
+    _helper_wakeups.fetch_add(1, std::memory_order_release);
+    impl::Futex::wake_all(_helper_wakeups);
+}
+
+inline void Static_thread_pool::stop_spinning() {
+    // The last spinner may have absorbed wakeups for more than one node
+    if(_spinners.fetch_sub(1, std::memory_order_relaxed) == 1) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(pending_hint()) notify_sleeper();
+    }
+}
+
+inline void Static_thread_pool::on_work_started(size_t count) noexcept {
+    _outstanding_work.fetch_add(count, std::memory_order_relaxed);
+}
+
+inline void Static_thread_pool::on_work_finished(size_t count) noexcept {
+    if(_outstanding_work.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        // Parked workers may exit now if users are wait()-ing
+        notify_all_sleepers();
+        // So does the wait()-ing caller
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_helpers.load(std::memory_order_relaxed)) wake_helpers();
+    }
+}
+
+inline Static_thread_pool::Detached_guard::Detached_guard(Static_thread_pool *pool) noexcept: _pool(pool) {
+    _pool->_detached.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in park()
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline Static_thread_pool::Detached_guard::~Detached_guard() {
+    // The last one lets parked workers recheck the exit condition of wait()
+    if(_pool->_detached.fetch_sub(1, std::memory_order_acq_rel) == 1
+            && !_pool->_running.load(std::memory_order_relaxed)) {
+        // Pairs with the fence in park()
+        // Either the sleeper sees the decrement, or we see the sleeper
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_pool->_sleepers.load(std::memory_order_relaxed)) _pool->notify_all_sleepers();
+    }
+}
+
+inline bool Static_thread_pool::pending_hint() const {
+    for(size_t i = 0; i < _injection_queues_size; ++i) {
+        if(!_injection_queues[i].empty_hint()) return true;
+    }
+    for(size_t i = 0, used = workers_used(); i < used; ++i) {
+        if(!_workers[i]._deque.empty_hint()) return true;
+    }
+    return false;
+}
+
+#if defined(BSIO_POOL_STATS)
+inline auto Static_thread_pool::stats() const -> Stats {
+    using Counters = impl::Worker_counters<true>;
+    using std::chrono::nanoseconds;
+    Stats stats {
+        .active_workers = _active_workers.load(std::memory_order_relaxed),
+        .sleepers = _sleepers.load(std::memory_order_relaxed),
+        .pending_injection_queues = 0,
+        .outstanding_work = _outstanding_work.load(std::memory_order_relaxed),
+        .workers = {},
+        .external = {}
+    };
+    for(size_t i = 0; i < _injection_queues_size; ++i) {
+        if(!_injection_queues[i].empty_hint()) ++stats.pending_injection_queues;
+    }
+    for(size_t i = 0, used = workers_used(); i < used; ++i) {
+        auto &worker = _workers[i];
+        auto &counters = worker._stats;
+        stats.workers.push_back({
+            .alive = worker._alive.load(std::memory_order_relaxed),
+            .cpu = worker._cpu,
+            .tasks = worker._dispatched.load(std::memory_order_relaxed),
+            .steals = Counters::load(counters._steals),
+            .injected = Counters::load(counters._injected),
+            .parks = Counters::load(counters._parks),
+            .wakeups = Counters::load(counters._wakeups),
+            .busy = nanoseconds(Counters::load(counters._busy)),
+            .idle = nanoseconds(Counters::load(counters._idle)),
+            .queue_depth = worker._deque.size_hint(),
+            .latency_sum = nanoseconds(Counters::load(counters._latency_sum)),
+            .latency_max = nanoseconds(Counters::load(counters._latency_max))
+        });
+    }
+    stats.external = {
+        .tasks = Counters::load(_external_stats._tasks),
+        .busy = nanoseconds(Counters::load(_external_stats._busy)),
+        .latency_sum = nanoseconds(Counters::load(_external_stats._latency_sum)),
+        .latency_max = nanoseconds(Counters::load(_external_stats._latency_max))
+    };
+    return stats;
+}
+#endif
+
+inline void Static_thread_pool::start_worker(Worker *worker) {
+    size_t index = worker - &_workers[0];
+    if(index >= _workers_used.load(std::memory_order_relaxed)) {
+        _workers_used.store(index + 1, std::memory_order_release);
+    }
+    worker->_alive.store(true, std::memory_order_relaxed);
+    worker->_thread = std::thread([this, worker] {
+        // Best effort
+        if(worker->_cpu >= 0) impl::pin_this_thread(worker->_cpu);
+        attach_worker(worker);
+        worker->_alive.store(false, std::memory_order_release);
+    });
+}
+
+inline bool Static_thread_pool::spawn_worker() {
     std::lock_guard lock{_mutex};
-    _stopped = true;
-    _cv.notify_all();
+    if(_joining.load(std::memory_order_relaxed)) return false;
+    if(_active_workers.load(std::memory_order_relaxed) >= _elastic_policy.max_threads) return false;
+    for(size_t index = 0; index < _workers_size; ++index) {
+        auto &worker = _workers[index];
+        if(worker._alive.load(std::memory_order_acquire)) continue;
+        // A retired one, it has left attach_worker()
+        if(worker._thread.joinable()) worker._thread.join();
+        _active_workers.fetch_add(1, std::memory_order_relaxed);
+        start_worker(&worker);
+        return true;
+    }
+    return false;
+}
+
+inline bool Static_thread_pool::retire_worker() {
+    size_t active = _active_workers.load(std::memory_order_relaxed);
+    while(active > _elastic_policy.min_threads) {
+        if(_active_workers.compare_exchange_weak(active, active - 1, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t Static_thread_pool::dispatched() const {
+    uint64_t sum = 0;
+    for(size_t i = 0, used = workers_used(); i < used; ++i) {
+        sum += _workers[i]._dispatched.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+inline void Static_thread_pool::supervise() {
+    auto finished = [this] {
+        return _stopped.load(std::memory_order_relaxed) || _joining.load(std::memory_order_relaxed);
+    };
+    for(uint64_t last = dispatched(); !finished();) {
+        auto wakeups = _supervisor_wakeups.load(std::memory_order_acquire);
+        if(finished()) return;
+        // All workers are retired, see notify_sleeper()
+        if(!_active_workers.load(std::memory_order_relaxed) && pending_hint()) {
+            spawn_worker();
+        }
+        impl::Futex::wait_until(_supervisor_wakeups, wakeups,
+            Timer_clock::now() + _elastic_policy.spawn_threshold);
+        // No progress but nodes are queued, workers may be blocked
+        uint64_t current = dispatched();
+        if(current == last && pending_hint()) {
+            spawn_worker();
+        }
+        last = current;
+    }
+}
+
+inline void Static_thread_pool::wake_supervisor() {
+    _supervisor_wakeups.fetch_add(1, std::memory_order_release);
+    impl::Futex::wake_all(_supervisor_wakeups);
+}
+
+inline bool Static_thread_pool::run_one() {
+    if(_stopped.load(std::memory_order_relaxed)) return false;
+    poll_timers();
+    // A worker (in a node) takes from its private deque first
+    Worker *worker = nullptr;
+    if(auto *private_data = This_thread_private_data::instance()) {
+        if(private_data->_owner == this) worker = private_data->_worker;
+    }
+    // A worker is never counted, it does not exit while running a node
+    std::optional<Detached_guard> guard;
+    if(!worker) {
+        if(!pending_hint()) return false;
+        guard.emplace(this);
+    }
+    auto node = take(worker);
+    if(!node) return false;
+    // A worker in a node is already busy, only the node itself is counted
+    uint64_t busy_since = impl::stats_now();
+    if(worker) {
+        worker->_dispatched.store(worker->_dispatched.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        worker->_stats.on_started(busy_since - node->_enqueued.time());
+    } else {
+        _external_stats.on_started(busy_since - node->_enqueued.time());
+    }
+    auto id = node.get();
+    impl::trace(impl::Trace_type::start, id);
+    Function_node::run(std::move(node));
+    impl::trace(impl::Trace_type::end, id);
+    if(!worker) _external_stats.on_busy(impl::stats_now() - busy_since);
+    return true;
+}
+
+inline bool Static_thread_pool::run_until(std::predicate auto pred) {
+    impl::Backoff backoff {_idle_policy.spin_rounds, _idle_policy.yield_rounds};
+    while(!pred()) {
+        // Nothing would be taken
+        if(_stopped.load(std::memory_order_relaxed)) return false;
+        if(run_one()) {
+            backoff.reset();
+            continue;
+        }
+        if(backoff.pause()) continue;
+        backoff.reset();
+        // Pairs with the fence in notify_sleeper(), see also park()
+        _helpers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto wakeups = _helper_wakeups.load(std::memory_order_acquire);
+        if(!pred() && !pending_hint() && !_stopped.load(std::memory_order_relaxed)) {
+            impl::Futex::wait_until(_helper_wakeups, wakeups, Timer_clock::now() + helper_park_timeout);
+        }
+        _helpers.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+inline void Static_thread_pool::stop() {
+    _stopped.store(true, std::memory_order_relaxed);
+    notify_all_sleepers();
+    wake_helpers();
+    wake_supervisor();
 }
 
 inline void Static_thread_pool::wait() {
     std::unique_lock lock{_mutex};
-    auto threads = std::move(_threads);
-    if(!threads.empty()) {
-        // TODO outstading work
-        --_running;
-        _cv.notify_all();
-        lock.unlock();
-        for(auto &&thread : threads) {
-            thread.join();
+    if(_joining.exchange(true, std::memory_order_relaxed)) return;
+    _running.fetch_sub(1, std::memory_order_relaxed);
+    lock.unlock();
+    notify_all_sleepers();
+    // Caller-runs, drain queued nodes with the workers
+    run_until([this] {
+        return _stopped.load(std::memory_order_relaxed)
+            || (!_outstanding_work.load(std::memory_order_acquire) && !pending_hint());
+    });
+    wake_supervisor();
+    if(_supervisor.joinable()) {
+        _supervisor.join();
+    }
+    // No slot is changed after _joining is set
+    for(size_t index = 0; index < _workers_size; ++index) {
+        if(_workers[index]._thread.joinable()) {
+            _workers[index]._thread.join();
         }
     }
 }
 
-inline Static_thread_pool::This_thread_private_data::This_thread_private_data(Static_thread_pool *owner)
-    : _owner(owner), _prev_thread_data(instance()) {
+inline Static_thread_pool::Worker::~Worker() {
+    // Release the remaining nodes after stop()
+    while(auto node = _deque.pop()) {
+        Function_node_handle{node};
+    }
+}
+
+inline Static_thread_pool::This_thread_private_data::This_thread_private_data(Static_thread_pool *owner, Worker *worker)
+    : _owner(owner), _worker(worker), _prev_thread_data(instance()) {
     instance() = this;
 }
 
@@ -393,27 +2117,43 @@ inline Static_thread_pool::This_thread_private_data*& Static_thread_pool::This_t
     return obj;
 }
 
-inline void Static_thread_pool::This_thread_private_data::private_queue_push(auto functor) {
+inline void Static_thread_pool::This_thread_private_data::private_queue_push(auto functor, const auto &alloc) {
+    if(!_run_next) {
+        _run_next = Function_node::make(std::move(functor), alloc);
+        return;
+    }
     _prev_tail_ptr = _tail_ptr;
-    *_tail_ptr = std::make_unique<Function_node>(std::move(functor));
+    *_tail_ptr = Function_node::make(std::move(functor), alloc);
     _tail_ptr = &((*_tail_ptr)->_next);
-    
+    ++_private_size;
 }
 
-inline void Static_thread_pool::This_thread_private_data::private_queue_detach() {
+inline auto Static_thread_pool::This_thread_private_data::private_queue_detach() -> Function_node_handle {
+    if constexpr (impl::pool_trace_enabled) {
+        // Published one by one, each has its own flow
+        // _run_next is traced by the caller, which may publish it too
+        for(auto node = _head.get(); node; node = node->_next.get()) {
+            impl::trace(impl::Trace_type::submit, node, 1);
+        }
+    }
     if(!private_queue_empty()) {
-        auto queue_access = _owner->_queue_access;
-        auto &non_empty_tail = *_prev_tail_ptr;
-        if(_head == non_empty_tail) {
-            queue_access.push(_owner->_list_head, std::move(_head));
+        if(_worker) {
+            // FIFO: _head is the next one to pop
+            _worker->_deque.push_chain(_head.release(), _private_size,
+                [](Function_node *node) { return node->_next.release(); });
+            _owner->notify_sleeper();
         } else {
-            queue_access.push(_owner->_list_head, std::move(_head), non_empty_tail);
+            auto non_empty_tail = _prev_tail_ptr->get();
+            _owner->this_thread_injection_queue().push(std::move(_head), non_empty_tail);
+            _owner->notify_sleeper();
         }
 
         // reset to empty private list
         _tail_ptr = &_head;
         _prev_tail_ptr = nullptr;
+        _private_size = 0;
     }
+    return std::move(_run_next);
 }
 
 inline bool Static_thread_pool::This_thread_private_data::private_queue_empty() const {
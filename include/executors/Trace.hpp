@@ -0,0 +1,165 @@
+#pragma once
+#include <ostream>
+#include <mutex>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "impl/Trace_buffer.hpp"
+namespace bsio {
+
+// Write events recorded by Static_thread_pool (BSIO_POOL_TRACE) as Chrome trace JSON
+// Open it with chrome://tracing or https://ui.perfetto.dev
+//
+// - task:    a slice from start to end, with a flow arrow from its submission
+// - park:    a slice from park to wake
+// - submit, steal: instant events
+//
+// Threads keep running, events being overwritten during the dump are dropped
+// Note: an empty trace is written if BSIO_POOL_TRACE is not defined
+void write_chrome_trace(std::ostream &os);
+
+
+namespace impl {
+
+struct Trace_record {
+    uint64_t _time;
+    uint64_t _id;
+    Trace_type _type;
+    uint32_t _arg;
+};
+
+// A consistent copy of the ring, oldest first
+// Events being written, or overwritten while copying, are skipped
+inline std::vector<Trace_record> read_trace_buffer(const Trace_buffer &buffer) {
+    constexpr auto capacity = Trace_buffer::capacity;
+    auto head = buffer._head.load(std::memory_order_acquire);
+    auto first = head > capacity ? head - capacity : 0;
+    std::vector<Trace_record> records;
+    records.reserve(head - first);
+    for(auto i = first; i < head; ++i) {
+        auto &event = buffer._events[i & (capacity - 1)];
+        auto sequence = event._sequence.load(std::memory_order_acquire);
+        if(sequence != 2 * i + 2) continue;
+        Trace_record record {
+            event._time.load(std::memory_order_relaxed),
+            event._id.load(std::memory_order_relaxed),
+            static_cast<Trace_type>(event._type.load(std::memory_order_relaxed)),
+            event._arg.load(std::memory_order_relaxed)
+        };
+        // Pairs with the fence in Trace_buffer::write()
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(event._sequence.load(std::memory_order_relaxed) != sequence) continue;
+        records.push_back(record);
+    }
+    return records;
+}
+
+// A JSON string literal
+inline std::string json_quote(std::string_view text) {
+    std::string quoted {'"'};
+    for(unsigned char c : text) {
+        if(c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if(c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", c);
+            quoted += escaped;
+        } else {
+            quoted += static_cast<char>(c);
+        }
+    }
+    quoted += '"';
+    return quoted;
+}
+
+} // namespace impl
+
+
+inline void write_chrome_trace(std::ostream &os) {
+    using impl::Trace_type;
+    auto &registry = impl::Trace_registry::instance();
+    auto buffers = registry.buffers();
+
+    std::vector<std::vector<impl::Trace_record>> threads;
+    uint64_t epoch = std::numeric_limits<uint64_t>::max();
+    for(auto &buffer : buffers) {
+        threads.push_back(impl::read_trace_buffer(*buffer));
+        for(auto &record : threads.back()) epoch = std::min(epoch, record._time);
+    }
+
+    char line[256];
+    bool first_line = true;
+    auto emit = [&](const char *format, auto ...args) {
+        std::snprintf(line, sizeof line, format, args...);
+        os << (first_line ? "\n" : ",\n") << line;
+        first_line = false;
+    };
+
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for(size_t i = 0; i < buffers.size(); ++i) {
+        auto tid = buffers[i]->_tid;
+        std::string name;
+        {
+            std::lock_guard lock {registry._mutex};
+            name = buffers[i]->_name;
+        }
+        // Not formatted into the line buffer, a long name would be cut
+        if(!name.empty()) {
+            emit(R"({"ph":"M","name":"thread_name","pid":1,"tid":%u,"args":{"name":)", tid);
+            os << impl::json_quote(name) << "}}";
+        }
+        // The ring may start in the middle of a slice
+        // Tasks may nest, e.g. run_until() in a task
+        size_t tasks = 0;
+        bool parked = false;
+        for(auto &record : threads[i]) {
+            double ts = (record._time - epoch) / 1000.0;
+            auto id = static_cast<unsigned long long>(record._id);
+            switch(record._type) {
+                case Trace_type::submit:
+                    // One instant event per submission, one flow per node
+                    if(record._arg) {
+                        emit(R"({"ph":"i","s":"t","name":"submit","pid":1,"tid":%u,"ts":%.3f,"args":{"node":"0x%llx","count":%u}})",
+                             tid, ts, id, record._arg);
+                    }
+                    emit(R"({"ph":"s","name":"task","cat":"bsio","id":"0x%llx","pid":1,"tid":%u,"ts":%.3f})",
+                         id, tid, ts);
+                    break;
+                case Trace_type::start:
+                    ++tasks;
+                    emit(R"({"ph":"B","name":"task","cat":"bsio","pid":1,"tid":%u,"ts":%.3f,"args":{"node":"0x%llx"}})",
+                         tid, ts, id);
+                    emit(R"({"ph":"f","bp":"e","name":"task","cat":"bsio","id":"0x%llx","pid":1,"tid":%u,"ts":%.3f})",
+                         id, tid, ts);
+                    break;
+                case Trace_type::end:
+                    if(!tasks) break;
+                    --tasks;
+                    emit(R"({"ph":"E","pid":1,"tid":%u,"ts":%.3f})", tid, ts);
+                    break;
+                case Trace_type::park:
+                    parked = true;
+                    emit(R"({"ph":"B","name":"park","cat":"bsio","pid":1,"tid":%u,"ts":%.3f})", tid, ts);
+                    break;
+                case Trace_type::wake:
+                    if(!parked) break;
+                    parked = false;
+                    emit(R"({"ph":"E","pid":1,"tid":%u,"ts":%.3f,"args":{"woken":%u}})", tid, ts, record._arg);
+                    break;
+                case Trace_type::steal:
+                    emit(R"({"ph":"i","s":"t","name":"steal","pid":1,"tid":%u,"ts":%.3f,"args":{"node":"0x%llx","victim":%u}})",
+                         tid, ts, id, record._arg);
+                    break;
+            }
+        }
+    }
+    os << "\n]}\n";
+}
+
+} // namespace bsio
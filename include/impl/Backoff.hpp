@@ -0,0 +1,59 @@
+#pragma once
+#include <thread>
+#include <algorithm>
+#include <cstddef>
+
+namespace bsio {
+namespace impl {
+
+// Hint the CPU that the calling thread is busy-waiting
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+// Spin -> yield -> block
+//
+// The first spin_rounds calls busy-wait with an exponentially growing
+// number of pause instructions, the next yield_rounds calls give up
+// the time slice, then the caller is told to block
+class Backoff {
+public:
+    Backoff(size_t spin_rounds, size_t yield_rounds) noexcept
+        : _spin_rounds(spin_rounds), _yield_rounds(yield_rounds) {}
+
+    // Return: false if the caller should block instead
+    bool pause() noexcept;
+
+    void reset() noexcept { _round = 0; }
+
+    // True if pause() has been called since the last reset()
+    bool waiting() const noexcept { return _round != 0; }
+
+private:
+    static constexpr size_t max_spin_shift = 6;
+
+    size_t _spin_rounds;
+    size_t _yield_rounds;
+    size_t _round {0};
+};
+
+inline bool Backoff::pause() noexcept {
+    if(_round < _spin_rounds) {
+        for(size_t i = size_t{1} << std::min(_round, max_spin_shift); i--;) {
+            cpu_relax();
+        }
+    } else if(_round < _spin_rounds + _yield_rounds) {
+        std::this_thread::yield();
+    } else {
+        return false;
+    }
+    ++_round;
+    return true;
+}
+
+} // namespace impl
+} // namespace bsio
@@ -0,0 +1,171 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <cstddef>
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+namespace bsio {
+namespace impl {
+
+// CPUs grouped by NUMA nodes
+//
+// Linux: read from /sys/devices/system/node
+// Others, or if sysfs is not available: a single node
+struct Cpu_topology {
+    // Keep only CPUs allowed for this process, and in `cpus` if not empty
+    // Nodes without any CPU kept are dropped
+    // numa_aware = false: all CPUs kept are in one node
+    static Cpu_topology detect(const std::vector<unsigned> &cpus, bool numa_aware);
+
+    // Return: index in _nodes, 0 if unknown
+    size_t node_of(int cpu) const;
+
+    size_t cpus_size() const;
+
+    // Node index -> CPU ids
+    // Never empty, a node may have no CPU ids if affinity is not supported
+    std::vector<std::vector<unsigned>> _nodes;
+    // CPU id -> node index
+    std::vector<size_t> _cpu_nodes;
+};
+
+// Parse a sysfs CPU list, e.g. "0-3,8,10-11"
+std::vector<unsigned> parse_cpu_list(const std::string &list);
+
+// CPUs allowed for the calling process
+std::vector<unsigned> this_process_cpus();
+
+// Return: false if not supported or failed
+bool pin_this_thread(unsigned cpu);
+
+// Return: -1 if not supported
+int this_thread_cpu();
+
+inline std::vector<unsigned> parse_cpu_list(const std::string &list) {
+    std::vector<unsigned> cpus;
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == std::string::npos) end = list.size();
+        auto range = list.substr(pos, end - pos);
+        pos = end + 1;
+        if(range.empty() || range == "\n") continue;
+        try {
+            size_t dash = range.find('-');
+            unsigned first = std::stoul(range.substr(0, dash));
+            unsigned last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for(auto cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch(...) {
+            // Malformed, ignore this range
+        }
+    }
+    return cpus;
+}
+
+#if defined(__linux__)
+
+inline std::vector<unsigned> this_process_cpus() {
+    std::vector<unsigned> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for(unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if(CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+inline bool pin_this_thread(unsigned cpu) {
+    if(cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+inline int this_thread_cpu() {
+    return ::sched_getcpu();
+}
+
+#else
+
+inline std::vector<unsigned> this_process_cpus() {
+    std::vector<unsigned> cpus(std::thread::hardware_concurrency());
+    for(unsigned cpu = 0; cpu < cpus.size(); ++cpu) cpus[cpu] = cpu;
+    return cpus;
+}
+
+inline bool pin_this_thread(unsigned) {
+    return false;
+}
+
+inline int this_thread_cpu() {
+    return -1;
+}
+
+#endif
+
+inline Cpu_topology Cpu_topology::detect(const std::vector<unsigned> &cpus, bool numa_aware) {
+    auto allowed = this_process_cpus();
+    if(!cpus.empty()) {
+        std::erase_if(allowed, [&](unsigned cpu) {
+            return std::find(cpus.begin(), cpus.end(), cpu) == cpus.end();
+        });
+    }
+
+    // System node -> allowed CPU ids
+    std::vector<std::vector<unsigned>> system_nodes;
+    if(numa_aware) {
+        std::string online;
+        if(std::ifstream file {"/sys/devices/system/node/online"}; std::getline(file, online)) {
+            for(auto node : parse_cpu_list(online)) {
+                std::string list;
+                std::ifstream file {"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+                if(!std::getline(file, list)) continue;
+                auto node_cpus = parse_cpu_list(list);
+                std::erase_if(node_cpus, [&](unsigned cpu) {
+                    return std::find(allowed.begin(), allowed.end(), cpu) == allowed.end();
+                });
+                system_nodes.emplace_back(std::move(node_cpus));
+            }
+        }
+    }
+
+    Cpu_topology topology;
+    for(auto &node_cpus : system_nodes) {
+        if(node_cpus.empty()) continue;
+        for(auto cpu : node_cpus) {
+            if(cpu >= topology._cpu_nodes.size()) topology._cpu_nodes.resize(cpu + 1, 0);
+            topology._cpu_nodes[cpu] = topology._nodes.size();
+        }
+        topology._nodes.emplace_back(std::move(node_cpus));
+    }
+    // Not NUMA aware, or sysfs is not available
+    if(topology._nodes.empty()) {
+        topology._nodes.emplace_back(std::move(allowed));
+    }
+    return topology;
+}
+
+inline size_t Cpu_topology::node_of(int cpu) const {
+    if(cpu < 0 || static_cast<size_t>(cpu) >= _cpu_nodes.size()) return 0;
+    return _cpu_nodes[cpu];
+}
+
+inline size_t Cpu_topology::cpus_size() const {
+    size_t size = 0;
+    for(auto &node_cpus : _nodes) size += node_cpus.size();
+    return size;
+}
+
+} // namespace impl
+} // namespace bsio
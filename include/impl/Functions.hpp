@@ -1,7 +1,12 @@
 #pragma once
 #include <cassert>
 #include <functional>
+#include <type_traits>
 #include <memory>
+#include <new>
+#include <cstddef>
+#include "Node_pool.hpp"
+#include "Pool_stats.hpp"
 
 namespace bsio {
 namespace impl {
@@ -10,20 +15,25 @@ namespace impl {
 using Function_signature = void();
 
 
+// Move-only and small-buffer-optimized function wrapper
+// Like std::move_only_function, but available in C++20,
+// and the inline size / the allocator for large targets are controllable
+template <typename Signature, size_t Inline_size>
+class Basic_function;
+
+
 // Any invocable function
-using Function = 
-#if __cplusplus >= 202300L // Well, I guess...
-            // Better support for move-only callable objects
-            // For example, the object below cannot be a stored target to `std::function`:
-            //     std::function<void()> f = [p = std::promise<void>{}]{};
-            std::move_only_function<Function_signature>;
-#else
-            std::function<Function_signature>;
-#endif
+// Better support for move-only callable objects
+// For example, the object below cannot be a stored target to `std::function`:
+//     std::function<void()> f = [p = std::promise<void>{}]{};
+//
+// Inline size is chosen to fit a Function_node in one cache line
+using Function = Basic_function<Function_signature, 6 * sizeof(void*)>;
 
 
 // Intrusive but RAII-supported template
-template <typename Derived> struct Intrusive_list;
+template <typename Derived, typename Deleter = std::default_delete<Derived>>
+struct Intrusive_list;
 
 
 // Function with callable object and sibling relationship
@@ -31,15 +41,21 @@ template <typename Derived> struct Intrusive_list;
 struct Function_node;
 
 
+// Release a node to Function_node_pool
+struct Function_node_deleter {
+    void operator()(Function_node *node) const noexcept;
+};
+
+
 // Type of list_head, without data field
-using Function_intrusive_list = Intrusive_list<Function_node>;
+using Function_intrusive_list = Intrusive_list<Function_node, Function_node_deleter>;
 
 
 // Type of queue node, with managed and movable resource
-using Function_node_handle = std::unique_ptr<Function_node>;
+using Function_node_handle = std::unique_ptr<Function_node, Function_node_deleter>;
 
 
-template <typename Derived>
+template <typename Derived, typename Deleter>
 struct Intrusive_list {
 
     // TODO remove template<>
@@ -48,19 +64,324 @@ struct Intrusive_list {
     //
     // -> struct Intrusive_list { n3974::unique_ptr<void> _next; };
 
-    std::unique_ptr<Derived> _next;
+    std::unique_ptr<Derived, Deleter> _next;
+};
+
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+class Basic_function<Ret(Args...), Inline_size> {
+public:
+    Basic_function() noexcept = default;
+    Basic_function(std::nullptr_t) noexcept {}
+
+    // Large targets are allocated by std::allocator
+    template <typename F>
+        requires (!std::is_same_v<std::decay_t<F>, Basic_function>)
+              && std::is_invocable_r_v<Ret, std::decay_t<F>&, Args...>
+    Basic_function(F &&f)
+        : Basic_function(std::allocator_arg, std::allocator<void>{}, std::forward<F>(f)) {}
+
+    // Large targets are allocated by alloc
+    template <typename Allocator, typename F>
+        requires (!std::is_same_v<std::decay_t<F>, Basic_function>)
+              && std::is_invocable_r_v<Ret, std::decay_t<F>&, Args...>
+    Basic_function(std::allocator_arg_t, const Allocator &alloc, F &&f);
+
+    Basic_function(Basic_function &&rhs) noexcept;
+    Basic_function& operator=(Basic_function &&rhs) noexcept;
+
+    Basic_function(const Basic_function &) = delete;
+    Basic_function& operator=(const Basic_function &) = delete;
+
+    ~Basic_function();
+
+    explicit operator bool() const noexcept { return _operations; }
+
+    // Return: nullptr if the target is not an inline stored F
+    template <typename F>
+    F* target() noexcept;
+
+    Ret operator()(Args ...args) {
+        assert(_operations);
+        return _operations->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+public:
+    template <typename F>
+    static constexpr bool is_inline_storable =
+        sizeof(F) <= Inline_size
+        && alignof(F) <= alignof(void*)
+        && std::is_nothrow_move_constructible_v<F>;
+
+private:
+    // Type-erased operations on _storage
+    struct Operations {
+        Ret (*invoke)(void *storage, Args&&...);
+        // Move-construct to `to`, and destroy `from`
+        void (*relocate)(void *to, void *from) noexcept;
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    // Target stored in _storage
+    template <typename F>
+    struct Inline_operations;
+
+    // Target stored in an allocated holder,
+    // and _storage keeps a pointer to the holder
+    template <typename F, typename Allocator>
+    struct Overflow_operations;
+
+private:
+    const Operations *_operations {nullptr};
+    alignas(void*) std::byte _storage[Inline_size];
+};
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+template <typename F>
+struct Basic_function<Ret(Args...), Inline_size>::Inline_operations {
+    static Ret invoke(void *storage, Args &&...args) {
+        // The result is discarded for void(), like std::function
+        if constexpr (std::is_void_v<Ret>) std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+        else return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+    }
+
+    static void relocate(void *to, void *from) noexcept {
+        ::new (to) F(std::move(*static_cast<F*>(from)));
+        static_cast<F*>(from)->~F();
+    }
+
+    static void destroy(void *storage) noexcept {
+        static_cast<F*>(storage)->~F();
+    }
+
+    static constexpr Operations value {&invoke, &relocate, &destroy};
+};
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+template <typename F, typename Allocator>
+struct Basic_function<Ret(Args...), Inline_size>::Overflow_operations {
+    struct Holder {
+        F _func;
+        Allocator _alloc [[no_unique_address]];
+    };
+
+    using Holder_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Holder>;
+    using Holder_traits = std::allocator_traits<Holder_allocator>;
+
+    static Holder*& holder(void *storage) {
+        return *static_cast<Holder**>(storage);
+    }
+
+    static Ret invoke(void *storage, Args &&...args) {
+        if constexpr (std::is_void_v<Ret>) std::invoke(holder(storage)->_func, std::forward<Args>(args)...);
+        else return std::invoke(holder(storage)->_func, std::forward<Args>(args)...);
+    }
+
+    static void relocate(void *to, void *from) noexcept {
+        holder(to) = holder(from);
+    }
+
+    static void destroy(void *storage) noexcept {
+        Holder *h = holder(storage);
+        Holder_allocator alloc {h->_alloc};
+        Holder_traits::destroy(alloc, h);
+        Holder_traits::deallocate(alloc, h, 1);
+    }
+
+    static constexpr Operations value {&invoke, &relocate, &destroy};
+};
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+template <typename Allocator, typename F>
+    requires (!std::is_same_v<std::decay_t<F>, Basic_function<Ret(Args...), Inline_size>>)
+          && std::is_invocable_r_v<Ret, std::decay_t<F>&, Args...>
+inline Basic_function<Ret(Args...), Inline_size>::Basic_function(std::allocator_arg_t, const Allocator &alloc, F &&f) {
+    using Target = std::decay_t<F>;
+    if constexpr (is_inline_storable<Target>) {
+        ::new (static_cast<void*>(_storage)) Target(std::forward<F>(f));
+        _operations = &Inline_operations<Target>::value;
+    } else {
+        using Operations = Overflow_operations<Target, Allocator>;
+        using Holder = typename Operations::Holder;
+        typename Operations::Holder_allocator holder_alloc {alloc};
+        Holder *h = Operations::Holder_traits::allocate(holder_alloc, 1);
+        try {
+            Operations::Holder_traits::construct(holder_alloc, h, Holder{std::forward<F>(f), alloc});
+        } catch(...) {
+            Operations::Holder_traits::deallocate(holder_alloc, h, 1);
+            throw;
+        }
+        Operations::holder(_storage) = h;
+        _operations = &Operations::value;
+    }
+}
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+inline Basic_function<Ret(Args...), Inline_size>::Basic_function(Basic_function &&rhs) noexcept
+    : _operations(rhs._operations) {
+    if(_operations) {
+        _operations->relocate(_storage, rhs._storage);
+        rhs._operations = nullptr;
+    }
+}
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+inline auto Basic_function<Ret(Args...), Inline_size>::operator=(Basic_function &&rhs) noexcept
+        -> Basic_function& {
+    if(&rhs == this) return *this;
+    this->~Basic_function();
+    return *::new (this) Basic_function(std::move(rhs));
+}
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+inline Basic_function<Ret(Args...), Inline_size>::~Basic_function() {
+    if(_operations) _operations->destroy(_storage);
+}
+
+template <typename Ret, typename ...Args, size_t Inline_size>
+template <typename F>
+inline F* Basic_function<Ret(Args...), Inline_size>::target() noexcept {
+    if constexpr (is_inline_storable<F>) {
+        if(_operations == &Inline_operations<F>::value) return std::launder(reinterpret_cast<F*>(_storage));
+    }
+    return nullptr;
+}
+
+
+// A call stored in a node embedded in its own storage,
+// e.g. an awaiter in a coroutine frame
+// The node is never pooled, and may be destroyed by the call itself
+struct Embedded_call {
+    void operator()() const { _call(_self); }
+
+    void (*_call)(void *self);
+    void *_self;
 };
 
 
+// A callable object of the caller, erased but not moved yet
+// The receiver either invokes it in place (blocking paths),
+// or constructs it into a Function directly, e.g. the Function of a node
+// So an erased submit costs no more than a direct one, see Polymorphic_executor
+// Note: large callable objects are allocated by std::allocator
+struct Function_emplacer {
+    // An lvalue is copied, an rvalue is moved
+    template <typename F>
+    static Function_emplacer of(F &&f) noexcept;
+
+    void operator()() const { _invoke(_functor); }
+
+    Function emplace() const { return _emplace(_functor); }
+
+    void *_functor;
+    void (*_invoke)(void *functor);
+    Function (*_emplace)(void *functor);
+};
+
+
+// A fixed-size node (one cache line)
+// Small callable objects are stored inline,
+// larger ones are allocated by the user-provided allocator
 struct Function_node: Function_intrusive_list {
-    Function_node() = default;
-    Function_node(std::invocable auto func): _func(std::move(func)) {}
-    Function_node(std::invocable auto func, Function_intrusive_list next)
-        : Intrusive_list{std::move(next)}, _func(std::move(func)) {}
+    // Create a node from pooled storage
+    static Function_node_handle make(std::invocable auto func, const auto &alloc);
+
+    // Create a node in user-provided storage
+    // The storage must outlive the node (until it is invoked or dropped)
+    static Function_node_handle embed(void *storage, Embedded_call call) noexcept;
+
+    // Invoke and release the node
+    // Use it instead of operator() if the node may be embedded
+    static void run(Function_node_handle node);
+
+    void operator()() { _func(); }
 
     Function _func;
+    // Empty unless BSIO_POOL_STATS is defined
+    [[no_unique_address]] Enqueue_stamp<> _enqueued;
+
+private:
+    explicit Function_node(Function func): _func(std::move(func)) { _enqueued.stamp(); }
+
+    // Constructed in _func, not moved
+    explicit Function_node(const Function_emplacer &emplacer): _func(emplacer.emplace()) { _enqueued.stamp(); }
 };
 
+// One more word for the stamp if stats are enabled
+inline constexpr size_t function_node_block_size = pool_stats_enabled ? 72 : 64;
+static_assert(sizeof(Function_node) == function_node_block_size);
+static_assert(Function::is_inline_storable<Embedded_call>);
+
+// Storage of an embedded node
+struct Function_node_storage {
+    alignas(Function_node) std::byte _bytes[sizeof(Function_node)];
+};
+
+using Function_node_pool = Node_pool<sizeof(Function_node), alignof(Function_node)>;
+
+
+inline Function_node_handle Function_node::make(std::invocable auto func, const auto &alloc) {
+    void *block = Function_node_pool::allocate();
+    try {
+        // Adopt an erased function directly, instead of wrapping it again
+        if constexpr (std::is_same_v<decltype(func), Function>) {
+            return Function_node_handle{::new (block) Function_node(std::move(func))};
+        } else if constexpr (std::is_same_v<decltype(func), Function_emplacer>) {
+            return Function_node_handle{::new (block) Function_node(func)};
+        } else {
+            return Function_node_handle{::new (block) Function_node(
+                Function(std::allocator_arg, alloc, std::move(func)))};
+        }
+    } catch(...) {
+        Function_node_pool::deallocate(block);
+        throw;
+    }
+}
+
+template <typename F>
+inline Function_emplacer Function_emplacer::of(F &&f) noexcept {
+    using Target = std::decay_t<F>;
+    return {
+        const_cast<void*>(static_cast<const void*>(std::addressof(f))),
+        [](void *functor) {
+            if constexpr (std::is_lvalue_reference_v<F>) {
+                // Like a direct submit, which invokes its own copy
+                Target copy = *static_cast<const Target*>(functor);
+                std::invoke(copy);
+            } else {
+                std::invoke(*static_cast<Target*>(functor));
+            }
+        },
+        [](void *functor) -> Function {
+            if constexpr (std::is_lvalue_reference_v<F>) {
+                return Function(*static_cast<const Target*>(functor));
+            } else {
+                return Function(std::move(*static_cast<Target*>(functor)));
+            }
+        }
+    };
+}
+
+inline Function_node_handle Function_node::embed(void *storage, Embedded_call call) noexcept {
+    return Function_node_handle{::new (storage) Function_node(Function(call))};
+}
+
+inline void Function_node::run(Function_node_handle node) {
+    if(node->_func.target<Embedded_call>()) {
+        // Nothing is touched after the call
+        (*node.release())();
+        return;
+    }
+    (*node)();
+}
+
+inline void Function_node_deleter::operator()(Function_node *node) const noexcept {
+    // Dropped before invoked, the storage is owned by others
+    bool is_embedded = node->_func.target<Embedded_call>();
+    node->~Function_node();
+    if(!is_embedded) Function_node_pool::deallocate(node);
+}
+
 
 struct Function_node_access {
     bool empty(Function_intrusive_list &list_head) const;
@@ -132,6 +453,9 @@ struct Function_traits<Ret(*)(Args...)>: public Function_traits<Ret(Args...)> {}
 template <typename Ret, typename ...Args>
 struct Function_traits<std::function<Ret(Args...)>>: public Function_traits<Ret(Args...)> {};
 
+template <typename Ret, typename ...Args, size_t Inline_size>
+struct Function_traits<Basic_function<Ret(Args...), Inline_size>>: public Function_traits<Ret(Args...)> {};
+
 template <typename Ret, typename C, typename ...Args>
 struct Function_traits<Ret(C::*)(Args...)>: public Function_traits<Ret(Args...)> {};
 
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <climits>
+#include <cstdint>
+#include <algorithm>
+#if defined(__linux__)
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+namespace bsio {
+namespace impl {
+
+// Wait/wake on a 32-bit word
+//
+// Unlike std::atomic<T>::wait(), a deadline is supported
+// Waiters and wakers must both use these functions
+// Note: spurious wakeups are possible, recheck the condition
+struct Futex {
+    using Clock = std::chrono::steady_clock;
+
+    // Block while word == old
+    static void wait(std::atomic<uint32_t> &word, uint32_t old);
+
+    // Block while word == old, until deadline
+    static void wait_until(std::atomic<uint32_t> &word, uint32_t old, Clock::time_point deadline);
+
+    // Wake up at most `count` waiters
+    static void wake(std::atomic<uint32_t> &word, int count);
+
+    static void wake_all(std::atomic<uint32_t> &word) { wake(word, INT_MAX); }
+};
+
+#if defined(__linux__)
+
+inline void Futex::wait(std::atomic<uint32_t> &word, uint32_t old) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+        FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+}
+
+inline void Futex::wait_until(std::atomic<uint32_t> &word, uint32_t old, Clock::time_point deadline) {
+    auto timeout = deadline - Clock::now();
+    if(timeout <= Clock::duration::zero()) return;
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds);
+    ::timespec relative {
+        .tv_sec = static_cast<time_t>(seconds.count()),
+        .tv_nsec = static_cast<long>(nanoseconds.count())
+    };
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+        FUTEX_WAIT_PRIVATE, old, &relative, nullptr, 0);
+}
+
+inline void Futex::wake(std::atomic<uint32_t> &word, int count) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word),
+        FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+#else
+
+// Portable fallback
+// Timed waits poll the word with a bounded sleep
+
+inline void Futex::wait(std::atomic<uint32_t> &word, uint32_t old) {
+    word.wait(old, std::memory_order_relaxed);
+}
+
+inline void Futex::wait_until(std::atomic<uint32_t> &word, uint32_t old, Clock::time_point deadline) {
+    constexpr auto max_sleep = std::chrono::milliseconds(1);
+    for(auto now = Clock::now(); now < deadline && word.load(std::memory_order_relaxed) == old; now = Clock::now()) {
+        std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, max_sleep));
+    }
+}
+
+inline void Futex::wake(std::atomic<uint32_t> &word, int count) {
+    if(count == INT_MAX) {
+        word.notify_all();
+    } else while(count--) {
+        word.notify_one();
+    }
+}
+
+#endif
+
+} // namespace impl
+} // namespace bsio
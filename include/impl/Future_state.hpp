@@ -0,0 +1,180 @@
+#pragma once
+#include <cassert>
+#include <atomic>
+#include <variant>
+#include <exception>
+#include <utility>
+#include <new>
+#include <cstdint>
+#include <type_traits>
+#include "Functions.hpp"
+#include "Node_pool.hpp"
+#include "Backoff.hpp"
+#include "Futex.hpp"
+
+namespace bsio {
+namespace impl {
+
+// Where continuations are submitted to, e.g. a thread pool
+// A null scheduler invokes continuations inline
+struct Future_scheduler {
+    void *_context {nullptr};
+    void (*_submit)(void *context, Function func) {nullptr};
+};
+
+
+// Shared state of a Promise/Future pair
+//
+// A single pooled block with an atomic state machine:
+// - ready:        the result is published by the producer
+// - waiting:      a consumer sleeps on _state (futex)
+// - continued:    a continuation is attached
+// Whoever sets its bit last (ready or continued) schedules the continuation
+template <typename T>
+struct Future_state {
+    static_assert(!std::is_reference_v<T>, "reference results are not supported");
+
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    // The producer and the consumer own one reference each
+    static Future_state* make(Future_scheduler scheduler);
+
+    void release() noexcept;
+
+    template <typename ...Args>
+    void set_value(Args &&...args);
+
+    void set_exception(std::exception_ptr exception);
+
+    bool is_ready() const noexcept { return _state.load(std::memory_order_acquire) & ready; }
+
+    // Spin, then sleep
+    void wait();
+
+    // Return: false if timeout
+    bool wait_until(Futex::Clock::time_point deadline);
+
+    // Schedule it at once if ready
+    // The continuation (and only it) is submitted to `scheduler`
+    void attach(Function continuation, Future_scheduler scheduler);
+
+    static constexpr uint32_t ready = 1;
+    static constexpr uint32_t waiting = 2;
+    static constexpr uint32_t continued = 4;
+
+    // Spin before sleeping, a result is often published within microseconds
+    static constexpr size_t spin_rounds = 64;
+    static constexpr size_t yield_rounds = 4;
+
+    std::atomic<uint32_t> _state {0};
+    std::atomic<uint32_t> _refs {2};
+    Future_scheduler _scheduler;
+    Function _continuation;
+    // monostate: not ready
+    std::variant<std::monostate, Value, std::exception_ptr> _result;
+
+private:
+    explicit Future_state(Future_scheduler scheduler): _scheduler(scheduler) {}
+
+    void publish();
+
+    void schedule(Function continuation);
+
+    static constexpr bool is_poolable = alignof(Future_state) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+};
+
+template <typename T>
+inline Future_state<T>* Future_state<T>::make(Future_scheduler scheduler) {
+    if constexpr (is_poolable) {
+        using Pool = Node_pool<sizeof(Future_state), alignof(Future_state)>;
+        void *block = Pool::allocate();
+        return ::new (block) Future_state(scheduler);
+    } else {
+        return new Future_state(scheduler);
+    }
+}
+
+template <typename T>
+inline void Future_state<T>::release() noexcept {
+    if(_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    if constexpr (is_poolable) {
+        using Pool = Node_pool<sizeof(Future_state), alignof(Future_state)>;
+        this->~Future_state();
+        Pool::deallocate(this);
+    } else {
+        delete this;
+    }
+}
+
+template <typename T>
+template <typename ...Args>
+inline void Future_state<T>::set_value(Args &&...args) {
+    _result.template emplace<1>(std::forward<Args>(args)...);
+    publish();
+}
+
+template <typename T>
+inline void Future_state<T>::set_exception(std::exception_ptr exception) {
+    _result.template emplace<2>(std::move(exception));
+    publish();
+}
+
+template <typename T>
+inline void Future_state<T>::publish() {
+    auto old = _state.fetch_or(ready, std::memory_order_acq_rel);
+    assert(!(old & ready));
+    // The producer still holds a reference, _state is alive
+    if(old & waiting) Futex::wake_all(_state);
+    if(old & continued) schedule(std::move(_continuation));
+}
+
+template <typename T>
+inline void Future_state<T>::wait() {
+    Backoff backoff {spin_rounds, yield_rounds};
+    while(!is_ready()) {
+        if(backoff.pause()) continue;
+        auto state = _state.load(std::memory_order_acquire);
+        if(state & ready) return;
+        // Tell the producer to wake us up
+        if(!(state & waiting) && !_state.compare_exchange_weak(state, state | waiting,
+                std::memory_order_acq_rel, std::memory_order_acquire)) continue;
+        Futex::wait(_state, state | waiting);
+    }
+}
+
+template <typename T>
+inline bool Future_state<T>::wait_until(Futex::Clock::time_point deadline) {
+    Backoff backoff {spin_rounds, yield_rounds};
+    while(!is_ready()) {
+        if(backoff.pause()) continue;
+        if(Futex::Clock::now() >= deadline) return false;
+        auto state = _state.load(std::memory_order_acquire);
+        if(state & ready) return true;
+        if(!(state & waiting) && !_state.compare_exchange_weak(state, state | waiting,
+                std::memory_order_acq_rel, std::memory_order_acquire)) continue;
+        Futex::wait_until(_state, state | waiting, deadline);
+    }
+    return true;
+}
+
+template <typename T>
+inline void Future_state<T>::attach(Function continuation, Future_scheduler scheduler) {
+    // Read by the producer only after `continued` is set
+    _scheduler = scheduler;
+    _continuation = std::move(continuation);
+    auto old = _state.fetch_or(continued, std::memory_order_acq_rel);
+    assert(!(old & continued));
+    if(old & ready) schedule(std::move(_continuation));
+}
+
+template <typename T>
+inline void Future_state<T>::schedule(Function continuation) {
+    if(_scheduler._submit) {
+        _scheduler._submit(_scheduler._context, std::move(continuation));
+    } else {
+        continuation();
+    }
+}
+
+} // namespace impl
+} // namespace bsio
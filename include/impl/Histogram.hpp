@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+namespace bsio {
+namespace impl {
+
+// Log-linear bucketing (HdrHistogram-like)
+//
+// Values below 2^sub_bucket_bits have exact buckets,
+// each larger power of two is split into 2^sub_bucket_bits linear buckets,
+// so the relative error is at most 1 / 2^sub_bucket_bits (6.25%)
+// Values above max_value are clamped into the last bucket
+struct Log_linear_buckets {
+    static constexpr size_t sub_bucket_bits = 4;
+    static constexpr size_t sub_buckets = size_t{1} << sub_bucket_bits;
+    // 2^40 nanoseconds, about 18 minutes
+    static constexpr size_t max_value_bits = 40;
+    static constexpr uint64_t max_value = (uint64_t{1} << max_value_bits) - 1;
+    static constexpr size_t size = (max_value_bits - sub_bucket_bits + 1) * sub_buckets;
+
+    static constexpr size_t index_of(uint64_t value) noexcept;
+
+    // The largest value of a bucket
+    static constexpr uint64_t upper_bound(size_t index) noexcept;
+};
+
+// Recorded concurrently with relaxed RMW, never locked
+struct Atomic_histogram {
+    void record(uint64_t value) noexcept {
+        _buckets[Log_linear_buckets::index_of(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, Log_linear_buckets::size> _buckets {};
+};
+
+constexpr size_t Log_linear_buckets::index_of(uint64_t value) noexcept {
+    if(value > max_value) value = max_value;
+    if(value < sub_buckets) return value;
+    // value in [2^exponent, 2^(exponent+1))
+    size_t exponent = std::bit_width(value) - 1;
+    size_t shift = exponent - sub_bucket_bits;
+    size_t sub_bucket = (value >> shift) & (sub_buckets - 1);
+    return (shift + 1) * sub_buckets + sub_bucket;
+}
+
+constexpr uint64_t Log_linear_buckets::upper_bound(size_t index) noexcept {
+    if(index < sub_buckets) return index;
+    size_t shift = index / sub_buckets - 1;
+    uint64_t sub_bucket = index % sub_buckets;
+    uint64_t lower = (sub_buckets + sub_bucket) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+static_assert(Log_linear_buckets::index_of(Log_linear_buckets::max_value) == Log_linear_buckets::size - 1);
+static_assert(Log_linear_buckets::upper_bound(Log_linear_buckets::size - 1) == Log_linear_buckets::max_value);
+static_assert(Log_linear_buckets::index_of(Log_linear_buckets::upper_bound(100)) == 100);
+
+} // namespace impl
+} // namespace bsio
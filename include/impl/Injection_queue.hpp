@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include "Functions.hpp"
+
+namespace bsio {
+namespace impl {
+
+// Lock-free queue for submissions from outside the pool
+//
+// Producers push nodes with a CAS loop (LIFO),
+// a consumer detaches the whole chain with a single exchange, or pops the newest node
+// Consumers are serialized by a try-lock, so a popped node is never freed and reused
+// by another consumer in the meantime (no ABA problem), producers never wait
+//
+// Padded to a cache line to avoid false sharing between shards
+struct alignas(64) Injection_queue {
+    Injection_queue() = default;
+    ~Injection_queue();
+
+    Injection_queue(const Injection_queue &) = delete;
+    Injection_queue& operator=(const Injection_queue &) = delete;
+
+    void push(Function_node_handle new_node);
+
+    // Merge a full list [new_node_first, ... , new_node_last]
+    // Note: new_node_last->_next is expected to be nullptr
+    void push(Function_node_handle new_node_first, Function_node *new_node_last);
+
+    // Return: the newest node, followed by older nodes
+    //         nullptr if empty, or taken by another consumer
+    Function_node_handle consume_all();
+
+    // Return: the newest node only
+    //         nullptr if empty, or taken by another consumer
+    Function_node_handle pop();
+
+    // May be stale
+    bool empty_hint() const;
+
+    std::atomic<Function_node*> _head {nullptr};
+    // Held by a consumer
+    std::atomic<bool> _consuming {false};
+};
+
+inline Injection_queue::~Injection_queue() {
+    // Iterative release, avoid deep recursion on a long chain
+    for(Function_node_handle node {_head.load(std::memory_order_acquire)}; node;) {
+        node = std::move(node->_next);
+    }
+}
+
+inline void Injection_queue::push(Function_node_handle new_node) {
+    auto last = new_node.get();
+    push(std::move(new_node), last);
+}
+
+inline void Injection_queue::push(Function_node_handle new_node_first, Function_node *new_node_last) {
+    assert(new_node_last && !new_node_last->_next);
+    Function_node *first = new_node_first.release();
+    Function_node *old_head = _head.load(std::memory_order_relaxed);
+    do {
+        // Never owned by a failed attempt
+        new_node_last->_next.release();
+        new_node_last->_next.reset(old_head);
+    } while(!_head.compare_exchange_weak(old_head, first,
+                std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline auto Injection_queue::consume_all() -> Function_node_handle {
+    if(empty_hint()) return nullptr;
+    if(_consuming.exchange(true, std::memory_order_acquire)) return nullptr;
+    Function_node_handle node {_head.exchange(nullptr, std::memory_order_acquire)};
+    _consuming.store(false, std::memory_order_release);
+    return node;
+}
+
+inline auto Injection_queue::pop() -> Function_node_handle {
+    if(empty_hint()) return nullptr;
+    if(_consuming.exchange(true, std::memory_order_acquire)) return nullptr;
+    // Only producers change _head now, and they never touch nodes in the queue
+    Function_node *head = _head.load(std::memory_order_acquire);
+    while(head && !_head.compare_exchange_weak(head, head->_next.get(),
+                    std::memory_order_acquire, std::memory_order_acquire));
+    _consuming.store(false, std::memory_order_release);
+    if(!head) return nullptr;
+    // Still owned by the queue
+    head->_next.release();
+    return Function_node_handle{head};
+}
+
+inline bool Injection_queue::empty_hint() const {
+    return !_head.load(std::memory_order_relaxed);
+}
+
+} // namespace impl
+} // namespace bsio
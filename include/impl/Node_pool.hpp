@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <new>
+#include <cstddef>
+
+namespace bsio {
+namespace impl {
+
+// Fixed-size block allocator for queue nodes
+//
+// Each thread owns a free list (no synchronization),
+// and exchanges full lists with a global depot (lock-free):
+// - A thread which releases more than local_capacity blocks
+//   moves its whole list to the depot
+// - A thread which runs out of blocks takes the whole depot
+//
+// This keeps producer/consumer patterns (e.g. submitted by one thread,
+// released by a worker) allocation-free in steady state
+template <size_t Block_size, size_t Block_align = alignof(std::max_align_t)>
+class Node_pool {
+public:
+    static_assert(Block_align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    static void* allocate();
+
+    static void deallocate(void *block) noexcept;
+
+private:
+    struct Block {
+        Block *_next;
+    };
+
+    static_assert(Block_size >= sizeof(Block));
+
+    struct Local_cache {
+        ~Local_cache();
+
+        void push(Block *block) noexcept;
+        Block* pop() noexcept;
+        // Move all blocks to the depot
+        void flush() noexcept;
+
+        Block *_head {nullptr};
+        Block *_tail {nullptr};
+        size_t _size {0};
+    };
+
+    static Local_cache& local();
+
+    // Note: blocks in the depot are never returned to the system,
+    //       a trivially destructible depot is safe to use in any thread exit
+    static std::atomic<Block*>& depot();
+
+    // Per-thread blocks before flushing
+    static constexpr size_t local_capacity = 1024;
+};
+
+template <size_t Block_size, size_t Block_align>
+inline void* Node_pool<Block_size, Block_align>::allocate() {
+    auto &cache = local();
+    if(auto block = cache.pop()) {
+        return block;
+    }
+    // Refill from the depot
+    if(auto head = depot().exchange(nullptr, std::memory_order_acquire)) {
+        for(auto block = head; block;) {
+            auto next = block->_next;
+            cache.push(block);
+            block = next;
+        }
+        return cache.pop();
+    }
+    return ::operator new(Block_size);
+}
+
+template <size_t Block_size, size_t Block_align>
+inline void Node_pool<Block_size, Block_align>::deallocate(void *block) noexcept {
+    auto &cache = local();
+    if(cache._size >= local_capacity) {
+        cache.flush();
+    }
+    cache.push(static_cast<Block*>(block));
+}
+
+template <size_t Block_size, size_t Block_align>
+inline Node_pool<Block_size, Block_align>::Local_cache::~Local_cache() {
+    flush();
+}
+
+template <size_t Block_size, size_t Block_align>
+inline void Node_pool<Block_size, Block_align>::Local_cache::push(Block *block) noexcept {
+    block->_next = _head;
+    if(!_head) _tail = block;
+    _head = block;
+    ++_size;
+}
+
+template <size_t Block_size, size_t Block_align>
+inline auto Node_pool<Block_size, Block_align>::Local_cache::pop() noexcept -> Block* {
+    auto block = _head;
+    if(block) {
+        _head = block->_next;
+        if(!_head) _tail = nullptr;
+        --_size;
+    }
+    return block;
+}
+
+template <size_t Block_size, size_t Block_align>
+inline void Node_pool<Block_size, Block_align>::Local_cache::flush() noexcept {
+    if(!_head) return;
+    auto &head = depot();
+    auto old_head = head.load(std::memory_order_relaxed);
+    do {
+        _tail->_next = old_head;
+    } while(!head.compare_exchange_weak(old_head, _head,
+                std::memory_order_release, std::memory_order_relaxed));
+    _head = _tail = nullptr;
+    _size = 0;
+}
+
+template <size_t Block_size, size_t Block_align>
+inline auto Node_pool<Block_size, Block_align>::local() -> Local_cache& {
+    static thread_local Local_cache cache;
+    return cache;
+}
+
+template <size_t Block_size, size_t Block_align>
+inline auto Node_pool<Block_size, Block_align>::depot() -> std::atomic<Block*>& {
+    static std::atomic<Block*> head {nullptr};
+    return head;
+}
+
+} // namespace impl
+} // namespace bsio
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace bsio {
+namespace impl {
+
+// Runtime statistics of Static_thread_pool
+//
+// Opt-in: define BSIO_POOL_STATS before including any bsio header
+// Otherwise every counter is an empty class, and updates are no-ops
+#if defined(BSIO_POOL_STATS)
+inline constexpr bool pool_stats_enabled = true;
+#else
+inline constexpr bool pool_stats_enabled = false;
+#endif
+
+using Stats_clock = std::chrono::steady_clock;
+
+// Nanoseconds of Stats_clock, 0 if disabled
+inline uint64_t stats_now() noexcept {
+    if constexpr (pool_stats_enabled) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Stats_clock::now().time_since_epoch()).count();
+    } else {
+        return 0;
+    }
+}
+
+// When a node is queued, for enqueue-to-start latency
+template <bool Enabled = pool_stats_enabled>
+struct Enqueue_stamp {
+    void stamp() noexcept {}
+    uint64_t time() const noexcept { return 0; }
+};
+
+template <>
+struct Enqueue_stamp<true> {
+    void stamp() noexcept { _time = stats_now(); }
+    uint64_t time() const noexcept { return _time; }
+
+    uint64_t _time {0};
+};
+
+// Counters of a worker
+// Written by the owner only, so a relaxed load-store is enough (no RMW),
+// and read by anyone without stopping the pool
+template <bool Enabled = pool_stats_enabled>
+struct Worker_counters {
+    void on_started(uint64_t /*latency*/) noexcept {}
+    void on_stolen() noexcept {}
+    void on_injected(uint64_t /*n*/) noexcept {}
+    void on_parked() noexcept {}
+    void on_woken() noexcept {}
+    void on_busy(uint64_t /*nanoseconds*/) noexcept {}
+    void on_idle(uint64_t /*nanoseconds*/) noexcept {}
+};
+
+// Padded, the owner never shares cache lines with others
+template <>
+struct alignas(64) Worker_counters<true> {
+    void on_started(uint64_t latency) noexcept;
+    void on_stolen() noexcept { add(_steals); }
+    void on_injected(uint64_t n) noexcept { add(_injected, n); }
+    void on_parked() noexcept { add(_parks); }
+    void on_woken() noexcept { add(_wakeups); }
+    void on_busy(uint64_t nanoseconds) noexcept { add(_busy, nanoseconds); }
+    void on_idle(uint64_t nanoseconds) noexcept { add(_idle, nanoseconds); }
+
+    static uint64_t load(const std::atomic<uint64_t> &counter) noexcept {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t n = 1) noexcept {
+        counter.store(load(counter) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> _steals {0};
+    std::atomic<uint64_t> _injected {0};
+    std::atomic<uint64_t> _parks {0};
+    std::atomic<uint64_t> _wakeups {0};
+    // Nanoseconds
+    std::atomic<uint64_t> _busy {0};
+    std::atomic<uint64_t> _idle {0};
+    std::atomic<uint64_t> _latency_sum {0};
+    std::atomic<uint64_t> _latency_max {0};
+};
+
+inline void Worker_counters<true>::on_started(uint64_t latency) noexcept {
+    add(_latency_sum, latency);
+    if(latency > load(_latency_max)) {
+        _latency_max.store(latency, std::memory_order_relaxed);
+    }
+}
+
+// Counters of non-worker threads running nodes: wait(), run_until(), run_one() and attached threads
+// Shared by any number of threads, so updates are RMW
+template <bool Enabled = pool_stats_enabled>
+struct External_counters {
+    void on_started(uint64_t /*latency*/) noexcept {}
+    void on_busy(uint64_t /*nanoseconds*/) noexcept {}
+};
+
+template <>
+struct alignas(64) External_counters<true> {
+    void on_started(uint64_t latency) noexcept;
+    void on_busy(uint64_t nanoseconds) noexcept { _busy.fetch_add(nanoseconds, std::memory_order_relaxed); }
+
+    std::atomic<uint64_t> _tasks {0};
+    // Nanoseconds
+    std::atomic<uint64_t> _busy {0};
+    std::atomic<uint64_t> _latency_sum {0};
+    std::atomic<uint64_t> _latency_max {0};
+};
+
+inline void External_counters<true>::on_started(uint64_t latency) noexcept {
+    _tasks.fetch_add(1, std::memory_order_relaxed);
+    _latency_sum.fetch_add(latency, std::memory_order_relaxed);
+    uint64_t max = _latency_max.load(std::memory_order_relaxed);
+    while(latency > max && !_latency_max.compare_exchange_weak(max, latency, std::memory_order_relaxed));
+}
+
+} // namespace impl
+} // namespace bsio
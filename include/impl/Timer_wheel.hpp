@@ -0,0 +1,194 @@
+#pragma once
+#include <bit>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "Functions.hpp"
+#include "Node_pool.hpp"
+
+namespace bsio {
+namespace impl {
+
+struct Timer_node;
+
+// Release a timer node to Timer_node_pool
+struct Timer_node_deleter {
+    void operator()(Timer_node *node) const noexcept;
+};
+
+using Timer_node_handle = std::unique_ptr<Timer_node, Timer_node_deleter>;
+
+// A function node waiting for its deadline (in ticks)
+struct Timer_node: Intrusive_list<Timer_node, Timer_node_deleter> {
+    static Timer_node_handle make(Function_node_handle node, uint64_t deadline);
+
+    Function_node_handle _node;
+    uint64_t _deadline;
+};
+
+using Timer_node_pool = Node_pool<sizeof(Timer_node), alignof(Timer_node)>;
+
+
+// Hierarchical timer wheel
+// Hashed and Hierarchical Timing Wheels
+// http://www.cs.columbia.edu/~nahum/w6998/papers/ton97-timing-wheels.pdf
+//
+// levels x 64 slots, a slot of level N covers 64^N ticks
+// A node is placed at the level where its deadline and now() first differ,
+// and is cascaded to lower levels when its slot is reached
+// Insertion and removal are O(1), empty slots are skipped with bitmaps
+//
+// Not thread-safe
+// Note: nodes with the same deadline are not ordered
+class Timer_wheel {
+public:
+    explicit Timer_wheel(uint64_t now = 0): _now(now) {}
+    ~Timer_wheel();
+
+    Timer_wheel(const Timer_wheel &) = delete;
+    Timer_wheel& operator=(const Timer_wheel &) = delete;
+
+public:
+    // Return: nullptr if inserted
+    //         the node itself if it is already expired
+    Timer_node_handle insert(Timer_node_handle node);
+
+    // Move to `now` (never backwards)
+    // expired(Timer_node_handle) is called for each expired node
+    void advance(uint64_t now, auto &&expired);
+
+    // The earliest tick that some slot needs processing
+    // May be earlier than any deadline (a cascade point)
+    // Return: `never` if empty
+    uint64_t next_deadline() const;
+
+    uint64_t now() const { return _now; }
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return !_size; }
+
+    static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+private:
+    static constexpr size_t level_bits = 6;
+    static constexpr size_t slots = 1 << level_bits;
+    static constexpr size_t levels = 6;
+    // Longer timeouts are clamped to this (2^36 ticks)
+    static constexpr uint64_t max_duration = uint64_t{1} << (level_bits * levels);
+
+    struct Level {
+        uint64_t _occupied {0};
+        Timer_node_handle _slots[slots];
+    };
+
+    struct Expiration {
+        size_t _level;
+        size_t _slot;
+        uint64_t _deadline;
+    };
+
+    static size_t level_for(uint64_t now, uint64_t deadline);
+
+    static constexpr uint64_t slot_range(size_t level) { return uint64_t{1} << (level * level_bits); }
+
+    static constexpr uint64_t level_range(size_t level) { return slot_range(level) * slots; }
+
+    // Return: false if empty
+    bool next_expiration(Expiration &expiration) const;
+
+private:
+    uint64_t _now;
+    size_t _size {0};
+    Level _levels[levels];
+};
+
+inline Timer_node_handle Timer_node::make(Function_node_handle node, uint64_t deadline) {
+    void *block = Timer_node_pool::allocate();
+    auto timer = ::new (block) Timer_node;
+    timer->_node = std::move(node);
+    timer->_deadline = deadline;
+    return Timer_node_handle{timer};
+}
+
+inline void Timer_node_deleter::operator()(Timer_node *node) const noexcept {
+    node->~Timer_node();
+    Timer_node_pool::deallocate(node);
+}
+
+inline Timer_wheel::~Timer_wheel() {
+    // Iterative release, avoid deep recursion on a long chain
+    for(auto &level : _levels) {
+        for(auto &slot : level._slots) {
+            for(auto node = std::move(slot); node;) {
+                node = std::move(node->_next);
+            }
+        }
+    }
+}
+
+inline size_t Timer_wheel::level_for(uint64_t now, uint64_t deadline) {
+    // At least level 0
+    uint64_t masked = (now ^ deadline) | (slots - 1);
+    masked = std::min(masked, max_duration - 1);
+    size_t significant = 63 - std::countl_zero(masked);
+    return significant / level_bits;
+}
+
+inline Timer_node_handle Timer_wheel::insert(Timer_node_handle node) {
+    if(node->_deadline <= _now) return node;
+    node->_deadline = std::min(node->_deadline, _now + max_duration - 1);
+    size_t level = level_for(_now, node->_deadline);
+    size_t slot = (node->_deadline >> (level * level_bits)) & (slots - 1);
+    auto &head = _levels[level]._slots[slot];
+    node->_next = std::move(head);
+    head = std::move(node);
+    _levels[level]._occupied |= uint64_t{1} << slot;
+    ++_size;
+    return nullptr;
+}
+
+inline bool Timer_wheel::next_expiration(Expiration &expiration) const {
+    for(size_t level = 0; level < levels; ++level) {
+        auto occupied = _levels[level]._occupied;
+        if(!occupied) continue;
+        size_t now_slot = (_now >> (level * level_bits)) & (slots - 1);
+        size_t slot = (std::countr_zero(std::rotr(occupied, now_slot)) + now_slot) & (slots - 1);
+        uint64_t level_start = _now & ~(level_range(level) - 1);
+        uint64_t deadline = level_start + slot * slot_range(level);
+        // Only the top level wraps around, see max_duration
+        if(deadline <= _now) deadline += level_range(level);
+        expiration = {level, slot, deadline};
+        return true;
+    }
+    return false;
+}
+
+inline uint64_t Timer_wheel::next_deadline() const {
+    Expiration expiration;
+    return next_expiration(expiration) ? expiration._deadline : never;
+}
+
+inline void Timer_wheel::advance(uint64_t now, auto &&expired) {
+    for(Expiration expiration; next_expiration(expiration) && expiration._deadline <= now;) {
+        _now = expiration._deadline;
+        auto &level = _levels[expiration._level];
+        auto node = std::move(level._slots[expiration._slot]);
+        level._occupied &= ~(uint64_t{1} << expiration._slot);
+        while(node) {
+            auto next = std::move(node->_next);
+            --_size;
+            // Expired, or cascaded to a lower level
+            if(auto rest = insert(std::move(node))) {
+                expired(std::move(rest));
+            }
+            node = std::move(next);
+        }
+    }
+    _now = std::max(_now, now);
+}
+
+} // namespace impl
+} // namespace bsio
@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace bsio {
+namespace impl {
+
+// Task timelines of Static_thread_pool
+//
+// Opt-in: define BSIO_POOL_TRACE before including any bsio header
+// Otherwise trace() is a no-op and no buffer is ever created
+// Memory: a ring of 16K events of 32 bytes, i.e. 512 KB per concurrently tracing thread
+#if defined(BSIO_POOL_TRACE)
+inline constexpr bool pool_trace_enabled = true;
+#else
+inline constexpr bool pool_trace_enabled = false;
+#endif
+
+enum class Trace_type: uint32_t {
+    // id: the node, arg: number of nodes submitted together,
+    // set on the first node of a chain, 0 on the others
+    submit,
+    // id: the node
+    start,
+    end,
+    park,
+    // arg: 1 if woken up, 0 if timed out (or the pool is exiting)
+    wake,
+    // id: the node, arg: index of the victim worker
+    steal,
+};
+
+// Compact, written with relaxed stores only
+// A seqlock: _sequence is odd while the event is written,
+// so a concurrent dump never races, and drops half-written events
+struct Trace_event {
+    // 2 * (index in the buffer) + 2 once written
+    std::atomic<uint64_t> _sequence {0};
+    std::atomic<uint64_t> _time {0};
+    std::atomic<uint64_t> _id {0};
+    std::atomic<uint32_t> _type {0};
+    std::atomic<uint32_t> _arg {0};
+};
+
+static_assert(sizeof(Trace_event) == 32);
+
+// A fixed-size ring of one thread, the oldest events are overwritten
+struct Trace_buffer {
+    // 512 KB of events
+    static constexpr size_t capacity = size_t{1} << 14;
+
+    explicit Trace_buffer(uint32_t tid): _tid(tid), _events(std::make_unique<Trace_event[]>(capacity)) {}
+
+    // Owner only
+    void write(Trace_type type, uint64_t id, uint32_t arg) noexcept;
+
+    uint32_t _tid;
+    // Guarded by the registry mutex
+    std::string _name;
+    // Total events written, never wraps
+    std::atomic<uint64_t> _head {0};
+    std::unique_ptr<Trace_event[]> _events;
+};
+
+// Buffers of all threads, kept after threads exit
+// The buffer of an exited thread is reused by the next new thread,
+// so the number of buffers is bounded by the peak of concurrently tracing threads,
+// e.g. retired and re-spawned elastic workers take over the same buffers
+// Its events stay in the ring (under the same tid) until they are overwritten
+class Trace_registry {
+public:
+    static Trace_registry& instance();
+
+    Trace_buffer& this_thread_buffer();
+
+    // e.g. "bsio worker 3"
+    void name_this_thread(std::string name);
+
+    // Shared ownership, safe to read while writers keep running
+    std::vector<std::shared_ptr<Trace_buffer>> buffers();
+
+    std::mutex _mutex;
+
+private:
+    // Return the buffer to the registry when its thread exits
+    struct Lease {
+        ~Lease() { instance().retire(std::move(_buffer)); }
+
+        std::shared_ptr<Trace_buffer> _buffer;
+    };
+
+    std::shared_ptr<Trace_buffer> make_buffer();
+
+    void retire(std::shared_ptr<Trace_buffer> buffer);
+
+    std::vector<std::shared_ptr<Trace_buffer>> _buffers;
+    // Buffers of exited threads
+    std::vector<std::shared_ptr<Trace_buffer>> _retired;
+};
+
+// Nanoseconds of steady_clock, the same as the dumped timestamps
+inline uint64_t trace_now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void trace(Trace_type type, const void *id = nullptr, uint32_t arg = 0) noexcept {
+    if constexpr (pool_trace_enabled) {
+        Trace_registry::instance().this_thread_buffer().write(type, reinterpret_cast<uintptr_t>(id), arg);
+    }
+}
+
+inline void Trace_buffer::write(Trace_type type, uint64_t id, uint32_t arg) noexcept {
+    auto head = _head.load(std::memory_order_relaxed);
+    auto &event = _events[head & (capacity - 1)];
+    event._sequence.store(2 * head + 1, std::memory_order_relaxed);
+    // Pairs with the fence in read_trace_buffer()
+    std::atomic_thread_fence(std::memory_order_release);
+    event._time.store(trace_now(), std::memory_order_relaxed);
+    event._id.store(id, std::memory_order_relaxed);
+    event._type.store(static_cast<uint32_t>(type), std::memory_order_relaxed);
+    event._arg.store(arg, std::memory_order_relaxed);
+    event._sequence.store(2 * head + 2, std::memory_order_release);
+    _head.store(head + 1, std::memory_order_release);
+}
+
+inline Trace_registry& Trace_registry::instance() {
+    static Trace_registry registry;
+    return registry;
+}
+
+inline Trace_buffer& Trace_registry::this_thread_buffer() {
+    // The registry also owns it, so events survive the thread
+    static thread_local Lease lease {make_buffer()};
+    return *lease._buffer;
+}
+
+inline void Trace_registry::name_this_thread(std::string name) {
+    if constexpr (pool_trace_enabled) {
+        auto &buffer = this_thread_buffer();
+        std::lock_guard lock {_mutex};
+        buffer._name = std::move(name);
+    }
+}
+
+inline auto Trace_registry::buffers() -> std::vector<std::shared_ptr<Trace_buffer>> {
+    std::lock_guard lock {_mutex};
+    return _buffers;
+}
+
+inline auto Trace_registry::make_buffer() -> std::shared_ptr<Trace_buffer> {
+    std::lock_guard lock {_mutex};
+    if(!_retired.empty()) {
+        auto buffer = std::move(_retired.back());
+        _retired.pop_back();
+        // The next owner names it again
+        buffer->_name.clear();
+        return buffer;
+    }
+    auto buffer = std::make_shared<Trace_buffer>(static_cast<uint32_t>(_buffers.size() + 1));
+    _buffers.push_back(buffer);
+    return buffer;
+}
+
+inline void Trace_registry::retire(std::shared_ptr<Trace_buffer> buffer) {
+    std::lock_guard lock {_mutex};
+    // Still named, its events are dumped under that name until it is reused
+    _retired.push_back(std::move(buffer));
+}
+
+} // namespace impl
+} // namespace bsio
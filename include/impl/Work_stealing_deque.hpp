@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace bsio {
+namespace impl {
+
+// Chase-Lev deque
+// Dynamic Circular Work-Stealing Deque
+// https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+//
+// Memory orders are taken from:
+// Correct and Efficient Work-Stealing for Weak Memory Models
+// https://fzn.fr/readings/ppopp13.pdf
+//
+// The owner thread push()es and pop()s at the bottom (LIFO),
+// other threads steal() at the top (FIFO)
+// Elements are raw pointers, ownership is managed by the caller
+template <typename T>
+class Work_stealing_deque {
+public:
+    explicit Work_stealing_deque(size_t capacity = 256);
+    ~Work_stealing_deque() = default;
+
+    Work_stealing_deque(const Work_stealing_deque &) = delete;
+    Work_stealing_deque& operator=(const Work_stealing_deque &) = delete;
+
+public:
+    // Owner only
+    void push(T *element);
+
+    // Owner only
+    // Push a chain of n elements, `first` will be the next one to pop()
+    // next(element) -> T*, returns the successor of element
+    void push_chain(T *first, size_t n, auto &&next);
+
+    // Owner only
+    // Return: nullptr if empty
+    T* pop();
+
+    // Any thread
+    // Return: nullptr if empty or lost the race
+    T* steal();
+
+    // Any thread, may be stale
+    bool empty_hint() const;
+
+    // Any thread, may be stale
+    size_t size_hint() const;
+
+private:
+    struct Buffer {
+        explicit Buffer(int64_t capacity);
+
+        int64_t capacity() const { return _mask + 1; }
+        T* get(int64_t index) const { return _slots[index & _mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, T *element) { _slots[index & _mask].store(element, std::memory_order_relaxed); }
+
+        // Copy [top, bottom) to a new buffer with double capacity
+        std::unique_ptr<Buffer> grow(int64_t top, int64_t bottom) const;
+
+        int64_t _mask;
+        std::unique_ptr<std::atomic<T*>[]> _slots;
+    };
+
+    // Owner only
+    Buffer* reserve(int64_t top, int64_t bottom, int64_t n);
+
+private:
+    alignas(64) std::atomic<int64_t> _top {0};
+    alignas(64) std::atomic<int64_t> _bottom {0};
+    std::atomic<Buffer*> _buffer;
+    // Retired buffers may still be read by stealers,
+    // they are released only when the deque is destroyed
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+};
+
+template <typename T>
+inline Work_stealing_deque<T>::Buffer::Buffer(int64_t capacity)
+    : _mask(capacity - 1), _slots(std::make_unique<std::atomic<T*>[]>(capacity)) {}
+
+template <typename T>
+inline auto Work_stealing_deque<T>::Buffer::grow(int64_t top, int64_t bottom) const
+        -> std::unique_ptr<Buffer> {
+    auto buffer = std::make_unique<Buffer>(capacity() * 2);
+    for(auto i = top; i != bottom; ++i) {
+        buffer->put(i, get(i));
+    }
+    return buffer;
+}
+
+template <typename T>
+inline Work_stealing_deque<T>::Work_stealing_deque(size_t capacity) {
+    int64_t power_of_two = 1;
+    while(power_of_two < static_cast<int64_t>(capacity)) power_of_two <<= 1;
+    _buffers.emplace_back(std::make_unique<Buffer>(power_of_two));
+    _buffer.store(_buffers.back().get(), std::memory_order_relaxed);
+}
+
+template <typename T>
+inline auto Work_stealing_deque<T>::reserve(int64_t top, int64_t bottom, int64_t n) -> Buffer* {
+    Buffer *buffer = _buffer.load(std::memory_order_relaxed);
+    while(bottom - top + n > buffer->capacity()) {
+        _buffers.emplace_back(buffer->grow(top, bottom));
+        buffer = _buffers.back().get();
+        _buffer.store(buffer, std::memory_order_release);
+    }
+    return buffer;
+}
+
+template <typename T>
+inline void Work_stealing_deque<T>::push(T *element) {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    Buffer *buffer = reserve(top, bottom, 1);
+    buffer->put(bottom, element);
+    // Release store instead of release fence, sanitizers can understand it
+    _bottom.store(bottom + 1, std::memory_order_release);
+}
+
+template <typename T>
+inline void Work_stealing_deque<T>::push_chain(T *first, size_t n, auto &&next) {
+    if(!n) return;
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    int64_t count = static_cast<int64_t>(n);
+    Buffer *buffer = reserve(top, bottom, count);
+    // The first element is placed on the bottom-most slot
+    T *element = first;
+    for(auto index = bottom + count - 1; index >= bottom; --index) {
+        T *successor = next(element);
+        buffer->put(index, element);
+        element = successor;
+    }
+    _bottom.store(bottom + count, std::memory_order_release);
+}
+
+template <typename T>
+inline T* Work_stealing_deque<T>::pop() {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    Buffer *buffer = _buffer.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    if(top > bottom) {
+        // Empty
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    T *element = buffer->get(bottom);
+    if(top == bottom) {
+        // The last one, race with stealers
+        if(!_top.compare_exchange_strong(top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            element = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return element;
+}
+
+template <typename T>
+inline T* Work_stealing_deque<T>::steal() {
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+    if(top >= bottom) return nullptr;
+
+    // Note: memory_order_consume is promoted to acquire
+    Buffer *buffer = _buffer.load(std::memory_order_acquire);
+    T *element = buffer->get(top);
+    if(!_top.compare_exchange_strong(top, top + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return element;
+}
+
+template <typename T>
+inline bool Work_stealing_deque<T>::empty_hint() const {
+    return size_hint() == 0;
+}
+
+template <typename T>
+inline size_t Work_stealing_deque<T>::size_hint() const {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+}
+
+} // namespace impl
+} // namespace bsio
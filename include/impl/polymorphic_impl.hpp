@@ -1,41 +1,139 @@
 #pragma once
+#include <array>
 #include <atomic>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <type_traits>
 #include "Functions.hpp"
+#include "executors/Outstanding_work.hpp"
 namespace bsio {
 namespace execution {
 namespace polymorphic_impl {
 
+// Inline storage of a polymorphic executor, vptr + 3 words
+inline constexpr size_t inline_size = 4 * sizeof(void*);
+
+// Small executors (e.g. Static_thread_pool executors) live in the storage of their owner,
+// larger ones are shared and reference-counted on the heap
+template <typename Executor_impl>
+inline constexpr bool fits_inline =
+    sizeof(void*) + sizeof(Executor_impl) <= inline_size
+    && alignof(Executor_impl) <= alignof(void*)
+    && std::is_nothrow_move_constructible_v<Executor_impl>;
+
+// A property has a static id in a polymorphic executor: its index in Supportable_properties
+// So require/prefer/query are dispatched by a table lookup in O(1)
+inline constexpr size_t unsupported_property = static_cast<size_t>(-1);
+
+template <typename Property, typename ...Supportable_properties>
+inline constexpr size_t property_id = [] {
+    constexpr bool matches[] = {std::is_same_v<Property, Supportable_properties>..., false};
+    for(size_t i = 0; i < sizeof...(Supportable_properties); ++i) {
+        if(matches[i]) return i;
+    }
+    return unsupported_property;
+}();
+
+// A tracked executor keeps its execution context busy while it lives,
+// e.g. Static_thread_pool::wait() does not return
+// Unknown if its outstanding_work is not a constant
+template <typename Executor>
+inline constexpr bool may_be_tracked = [] {
+    using Tracked = Outstanding_work::Tracked;
+    if constexpr (requires { Tracked::template static_query_v<Executor>; }) {
+        return static_cast<bool>(Tracked::template static_query_v<Executor>);
+    } else {
+        return requires(const Executor &ex) { bsio::query(ex, Tracked{}); };
+    }
+}();
+
+// The result of query() through a polymorphic executor
+// Default to bool, see Generic_property::value()
+template <typename Property>
+struct Query_result {
+    using type = bool;
+};
+
+template <typename Property>
+    requires requires { typename Property::polymorphic_query_result_type; }
+struct Query_result<Property> {
+    using type = typename Property::polymorphic_query_result_type;
+};
+
+template <typename Property>
+using Query_result_t = typename Query_result<Property>::type;
+
+// `storage`: inline_size bytes aligned to void*, owned by the caller
+// Functions returning Base* construct the result in `storage` if it fits
 struct Polymorphic_executor_base {
-    using Function = bsio::impl::Function;
+    using Function_emplacer = bsio::impl::Function_emplacer;
     using Base = Polymorphic_executor_base;
     virtual ~Polymorphic_executor_base() {}
-    virtual Base* clone() const = 0;
-    virtual void destroy() = 0;
+    virtual Base* clone(void *storage) const = 0;
+    // Move to `storage`, `this` is no longer used
+    virtual Base* relocate(void *storage) noexcept = 0;
+    virtual void destroy() noexcept = 0;
     virtual const void* target() const = 0;
     virtual void* target() = 0;
     virtual const std::type_info& target_type() const = 0;
     virtual bool equals(const Polymorphic_executor_base *ex) const = 0;
 
-    virtual void execute(Function f) = 0;
-    virtual Base* require(const std::type_info&, const void *p) const = 0;
-    virtual Base* prefer(const std::type_info&, const void *p) const = 0;
-    virtual void* query(const std::type_info&, const void *p) const = 0;
+    virtual void execute(Function_emplacer f) = 0;
+    // `id`: see property_id, `p`: the property
+    // Return: nullptr if the target cannot require it
+    virtual Base* require(size_t id, const void *p, void *storage) const = 0;
+    // Return: a copy if the target cannot prefer it
+    virtual Base* prefer(size_t id, const void *p, void *storage) const = 0;
+    // `result`: Query_result_t<Property>*, unchanged if the target cannot answer
+    virtual bool query(size_t id, const void *p, void *result) const = 0;
 };
 
 template <typename Executor_impl, typename ...Supportable_properties>
 class Polymorphic_executor: public Polymorphic_executor_base {
 public:
+    static constexpr bool is_inline = fits_inline<Executor_impl>;
+
+    using Target_type = Executor_impl;
+
     explicit Polymorphic_executor(const Executor_impl &ex): _ex_impl(ex) {}
     explicit Polymorphic_executor(Executor_impl &&ex): _ex_impl(std::move(ex)) {}
+
+    template <typename Executor>
+    static Polymorphic_executor_base* make(void *storage, Executor &&ex) {
+        if constexpr (is_inline) {
+            static_assert(sizeof(Polymorphic_executor) <= inline_size);
+            return ::new (storage) Polymorphic_executor(std::forward<Executor>(ex));
+        } else {
+            return new Polymorphic_executor(std::forward<Executor>(ex));
+        }
+    }
+
 public:
-    Polymorphic_executor_base* clone() const override {
-        auto ptr = const_cast<Polymorphic_executor*>(this);
-        _refcount.fetch_add(1, std::memory_order_relaxed);
-        return ptr;
+    Polymorphic_executor_base* clone(void *storage) const override {
+        if constexpr (is_inline) {
+            return ::new (storage) Polymorphic_executor(_ex_impl);
+        } else {
+            auto ptr = const_cast<Polymorphic_executor*>(this);
+            _shared._refcount.fetch_add(1, std::memory_order_relaxed);
+            return ptr;
+        }
+    }
+
+    Polymorphic_executor_base* relocate(void *storage) noexcept override {
+        if constexpr (is_inline) {
+            auto ptr = ::new (storage) Polymorphic_executor(std::move(_ex_impl));
+            this->~Polymorphic_executor();
+            return ptr;
+        } else {
+            return this;
+        }
     }
 
-    void destroy() override {
-        if(0 == _refcount.fetch_add(-1, std::memory_order_acq_rel)) {
+    void destroy() noexcept override {
+        if constexpr (is_inline) {
+            this->~Polymorphic_executor();
+        } else if(0 == _shared._refcount.fetch_add(-1, std::memory_order_acq_rel)) {
             delete this;
         }
     }
@@ -62,71 +160,148 @@ public:
         return false;
     }
 
-    void execute(Function f) override {
-        _ex_impl.execute(std::move(f));
+    // The target executor constructs the callable in its node if it can,
+    // otherwise it gets an erased Function
+    void execute(Function_emplacer f) override {
+        if constexpr (requires { _ex_impl.execute_emplace(f); }) {
+            _ex_impl.execute_emplace(f);
+        } else {
+            _ex_impl.execute(f.emplace());
+        }
     }
 
-    Polymorphic_executor_base* require(const std::type_info &t, const void *p) const override {
-        return require_impl(t, p);
+    Polymorphic_executor_base* require(size_t id, const void *p, void *storage) const override {
+        return require_table[id](*this, p, storage);
     }
 
-    Polymorphic_executor_base* prefer(const std::type_info &t, const void *p) const override {
-        return prefer_impl(t, p);
+    Polymorphic_executor_base* prefer(size_t id, const void *p, void *storage) const override {
+        return prefer_table[id](*this, p, storage);
     }
 
-    // TODO
-    void* query(const std::type_info&, const void *p) const override {
-        return nullptr;
+    bool query(size_t id, const void *p, void *result) const override {
+        return query_table[id](*this, p, result);
     }
 
 private:
-    template <size_t I = 0>
-    Polymorphic_executor_base* require_impl(const std::type_info &t, const void *p) const {
-        constexpr size_t size = sizeof...(Supportable_properties);
-        if constexpr (size == 0 || I >= size) {
-            return nullptr;
+    static constexpr size_t properties_size = sizeof...(Supportable_properties);
+
+    template <size_t I>
+    using Property = std::tuple_element_t<I, std::tuple<Supportable_properties...>>;
+
+    template <typename New_executor_impl>
+    using Converted = Polymorphic_executor<std::decay_t<New_executor_impl>, Supportable_properties...>;
+
+    using Convert_fn = Polymorphic_executor_base* (*)(const Polymorphic_executor&, const void *p, void *storage);
+    using Query_fn = bool (*)(const Polymorphic_executor&, const void *p, void *result);
+
+    // Stateless properties always convert to the same executor,
+    // so a shared executor keeps the shared results
+    // Tracked results are not kept, they would be tracked as long as this executor lives
+    template <size_t I, typename Result>
+    static constexpr bool is_memoizable = !is_inline && !Result::is_inline && std::is_empty_v<Property<I>>
+        && !may_be_tracked<typename Result::Target_type>;
+
+    template <size_t I>
+    static Polymorphic_executor_base* require_at(const Polymorphic_executor &self, const void *p, void *storage) {
+        using Prop = Property<I>;
+        if constexpr (requires(const Executor_impl &e, Prop prop) { bsio::require(e, prop); }) {
+            auto &prop = *static_cast<const Prop*>(p);
+            using Result = Converted<decltype(bsio::require(self._ex_impl, prop))>;
+            if constexpr (is_memoizable<I, Result>) {
+                return memoized(self._shared._required[I], storage,
+                                [&] { return Result::make(nullptr, bsio::require(self._ex_impl, prop)); });
+            } else {
+                return Result::make(storage, bsio::require(self._ex_impl, prop));
+            }
         } else {
-            using As_tuple = std::tuple<Supportable_properties...>;
-            using I_type = std::tuple_element_t<I, As_tuple>;
-            if constexpr (requires(Executor_impl e, I_type i) {
-                bsio::require(e, i);
-            }) {
-                if(t == typeid(I_type)) {
-                    using New_executor_impl = decltype(bsio::require(_ex_impl, *static_cast<const I_type *>(p)));
-                    return new Polymorphic_executor<New_executor_impl, Supportable_properties...>(
-                        bsio::require(_ex_impl, *static_cast<const I_type *>(p)));
-                }
+            return nullptr;
+        }
+    }
+
+    template <size_t I>
+    static Polymorphic_executor_base* prefer_at(const Polymorphic_executor &self, const void *p, void *storage) {
+        using Prop = Property<I>;
+        if constexpr (requires(const Executor_impl &e, Prop prop) { bsio::prefer(e, prop); }) {
+            auto &prop = *static_cast<const Prop*>(p);
+            using Result = Converted<decltype(bsio::prefer(self._ex_impl, prop))>;
+            if constexpr (is_memoizable<I, Result>) {
+                return memoized(self._shared._preferred[I], storage,
+                                [&] { return Result::make(nullptr, bsio::prefer(self._ex_impl, prop)); });
+            } else {
+                return Result::make(storage, bsio::prefer(self._ex_impl, prop));
             }
-            return require_impl<I+1>(t, p);
+        } else {
+            return self.clone(storage);
         }
     }
 
-    template <size_t I = 0>
-    Polymorphic_executor_base* prefer_impl(const std::type_info &t, const void *p) const {
-        constexpr size_t size = sizeof...(Supportable_properties);
-        if constexpr (size == 0 || I >= size) {
-            return this->clone();
+    template <size_t I>
+    static bool query_at(const Polymorphic_executor &self, const void *p, void *result) {
+        using Prop = Property<I>;
+        using Result = Query_result_t<Prop>;
+        if constexpr (requires(const Executor_impl &e, Prop prop) {
+            { bsio::query(e, prop) } -> std::convertible_to<Result>;
+        }) {
+            *static_cast<Result*>(result) = bsio::query(self._ex_impl, *static_cast<const Prop*>(p));
+            return true;
         } else {
-            using As_tuple = std::tuple<Supportable_properties...>;
-            using I_type = std::tuple_element_t<I, As_tuple>;
-            if constexpr (requires(Executor_impl e, I_type i) {
-                bsio::prefer(e, i);
-            }) {
-                if(t == typeid(I_type)) {
-                    using New_executor_impl = decltype(bsio::prefer(_ex_impl, *static_cast<const I_type *>(p)));
-                    return new Polymorphic_executor<New_executor_impl, Supportable_properties...>(
-                        bsio::prefer(_ex_impl, *static_cast<const I_type *>(p)));
-                }
+            return false;
+        }
+    }
+
+    // The first result is kept in `slot`, others share it
+    static Polymorphic_executor_base* memoized(std::atomic<Polymorphic_executor_base*> &slot,
+                                               void *storage, auto make) {
+        auto cached = slot.load(std::memory_order_acquire);
+        if(!cached) {
+            auto made = make();
+            if(slot.compare_exchange_strong(cached, made, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                cached = made;
+            } else {
+                made->destroy();
             }
-            return prefer_impl<I+1>(t, p);
         }
+        return cached->clone(storage);
     }
 
+    template <size_t ...Is>
+    static constexpr auto make_tables(std::index_sequence<Is...>) {
+        return std::tuple {
+            std::array<Convert_fn, properties_size> {&require_at<Is>...},
+            std::array<Convert_fn, properties_size> {&prefer_at<Is>...},
+            std::array<Query_fn, properties_size> {&query_at<Is>...}
+        };
+    }
+
+    static constexpr auto tables = make_tables(std::index_sequence_for<Supportable_properties...>{});
+    static constexpr auto require_table = std::get<0>(tables);
+    static constexpr auto prefer_table = std::get<1>(tables);
+    static constexpr auto query_table = std::get<2>(tables);
+
+private:
+    // Only for executors on the heap
+    struct Shared {
+        Shared() = default;
+        Shared(const Shared &) = delete;
+        ~Shared() {
+            for(auto &slot : _required) if(auto ex = slot.load(std::memory_order_acquire)) ex->destroy();
+            for(auto &slot : _preferred) if(auto ex = slot.load(std::memory_order_acquire)) ex->destroy();
+        }
+
+        // The number of owners - 1
+        std::atomic<int> _refcount {0};
+        // Memoized results, by property id
+        std::array<std::atomic<Polymorphic_executor_base*>, properties_size> _required {};
+        std::array<std::atomic<Polymorphic_executor_base*>, properties_size> _preferred {};
+    };
+
+    struct Inline {};
+
 private:
     Executor_impl _ex_impl;
-    mutable std::atomic<int> _refcount;
+    [[no_unique_address]] mutable std::conditional_t<is_inline, Inline, Shared> _shared;
 };
-    
+
 } // namespace polymorphic_impl
 } // namespace execution
 } // namespace bsio
@@ -0,0 +1,456 @@
+#pragma once
+#include <atomic>
+#include <tuple>
+#include <variant>
+#include <optional>
+#include <exception>
+#include <functional>
+#include <utility>
+#include <type_traits>
+#include <coroutine>
+#include <thread>
+#include "Functions.hpp"
+#include "Backoff.hpp"
+#include "Futex.hpp"
+
+namespace bsio {
+namespace impl {
+namespace senders_impl {
+
+// A small sender/receiver layer
+//
+// Sender:    `Value_type` (void or a single value type), and
+//            connect(receiver) && -> operation state
+// Receiver:  set_value(value) (or set_value() for void), and
+//            set_error(std::exception_ptr)
+// Operation: start() noexcept, neither copyable nor movable
+//
+// Operation states are returned as prvalues and nested by value,
+// so a composed chain lives in a single stack (or coroutine frame) object
+// Note: there is no stop channel, a node dropped by stop() never completes
+
+template <typename Sender>
+using Value_of = typename std::remove_cvref_t<Sender>::Value_type;
+
+template <typename Sender, typename Receiver>
+using Operation_of = decltype(std::declval<Sender>().connect(std::declval<Receiver>()));
+
+template <typename Sender>
+concept Typed_sender = requires { typename Value_of<Sender>; };
+
+// Storage of a value, void is allowed
+template <typename T>
+using Value_storage = std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>>;
+
+// Executors with a non-allocating path, e.g. Static_thread_pool
+template <typename Executor>
+concept Embeddable_executor = requires(Executor &ex, Function_node_storage &storage, Embedded_call call) {
+    ex.execute_embedded(storage, call);
+};
+
+struct Empty {};
+
+// Invoke f(values...) and deliver the result to receiver
+// Exceptions thrown by f are delivered as errors
+template <typename Receiver>
+inline void set_value_from(Receiver &receiver, auto &&f, auto &&...values) {
+    using Ret = std::invoke_result_t<decltype(f), decltype(values)...>;
+    if constexpr (std::is_void_v<Ret>) {
+        try {
+            std::invoke(std::forward<decltype(f)>(f), std::forward<decltype(values)>(values)...);
+        } catch(...) {
+            receiver.set_error(std::current_exception());
+            return;
+        }
+        receiver.set_value();
+    } else {
+        std::optional<Ret> result;
+        try {
+            result.emplace(std::invoke(std::forward<decltype(f)>(f), std::forward<decltype(values)>(values)...));
+        } catch(...) {
+            receiver.set_error(std::current_exception());
+            return;
+        }
+        receiver.set_value(std::move(*result));
+    }
+}
+
+
+
+template <typename Executor, typename Receiver>
+class Schedule_operation {
+public:
+    Schedule_operation(Executor ex, Receiver receiver)
+        : _ex(std::move(ex)), _receiver(std::move(receiver)) {}
+
+    Schedule_operation(const Schedule_operation &) = delete;
+    Schedule_operation& operator=(const Schedule_operation &) = delete;
+
+    void start() noexcept;
+
+private:
+    static void run(void *self) { static_cast<Schedule_operation*>(self)->_receiver.set_value(); }
+
+    static constexpr bool is_embeddable = Embeddable_executor<Executor>;
+
+    Executor _ex;
+    Receiver _receiver;
+    [[no_unique_address]] std::conditional_t<is_embeddable, Function_node_storage, Empty> _node;
+};
+
+template <typename Executor>
+class Schedule_sender {
+public:
+    using Value_type = void;
+
+    explicit Schedule_sender(Executor ex): _ex(std::move(ex)) {}
+
+    template <typename Receiver>
+    Schedule_operation<Executor, Receiver> connect(Receiver receiver) && {
+        return {std::move(_ex), std::move(receiver)};
+    }
+
+    // co_await bsio::schedule(ex)
+    auto operator co_await() &&;
+
+private:
+    Executor _ex;
+};
+
+// The awaiter is the node, like Static_thread_pool::Schedule_awaitable
+template <typename Executor>
+class Schedule_awaiter {
+public:
+    explicit Schedule_awaiter(Executor ex): _ex(std::move(ex)) {}
+
+    Schedule_awaiter(const Schedule_awaiter &) = delete;
+    Schedule_awaiter& operator=(const Schedule_awaiter &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    void await_resume() const noexcept {}
+
+private:
+    Executor _ex;
+    Function_node_storage _node;
+};
+
+// Other oneway executors, the coroutine is resumed by a submitted function object
+template <typename Executor>
+struct Execute_awaitable {
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        _ex.execute([handle] { handle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+
+    Executor _ex;
+};
+
+
+
+template <typename F, typename Receiver>
+struct Then_receiver {
+    void set_value(auto &&...values) {
+        set_value_from(_receiver, std::move(_func), std::forward<decltype(values)>(values)...);
+    }
+
+    void set_error(std::exception_ptr exception) noexcept { _receiver.set_error(std::move(exception)); }
+
+    F _func;
+    Receiver _receiver;
+};
+
+template <typename Sender, typename F>
+class Then_sender {
+public:
+    using Value_type = typename std::conditional_t<std::is_void_v<Value_of<Sender>>,
+        std::invoke_result<F>, std::invoke_result<F, Value_of<Sender>>>::type;
+
+    Then_sender(Sender sender, F func): _sender(std::move(sender)), _func(std::move(func)) {}
+
+    // The operation state of the predecessor is reused
+    template <typename Receiver>
+    auto connect(Receiver receiver) && {
+        return std::move(_sender).connect(Then_receiver<F, Receiver>{std::move(_func), std::move(receiver)});
+    }
+
+private:
+    Sender _sender;
+    F _func;
+};
+
+// sender | bsio::then(f)
+template <typename F>
+struct Then_closure {
+    F _func;
+};
+
+template <Typed_sender S, typename F>
+inline auto operator|(S &&sender, Then_closure<F> closure) {
+    return Then_sender<std::decay_t<S>, F>{std::forward<S>(sender), std::move(closure._func)};
+}
+
+
+
+// Value_type: a tuple of non-void values, or void if none
+template <typename ...Senders>
+struct When_all_traits {
+    template <typename T>
+    using Wrapped = std::conditional_t<std::is_void_v<T>, std::tuple<>, std::tuple<T>>;
+
+    using Values = decltype(std::tuple_cat(std::declval<Wrapped<Value_of<Senders>>>()...));
+
+    using Value_type = std::conditional_t<std::tuple_size_v<Values> == 0, void, Values>;
+};
+
+template <typename Receiver, typename ...Senders>
+class When_all_operation {
+public:
+    When_all_operation(std::tuple<Senders...> &&senders, Receiver receiver)
+        : _receiver(std::move(receiver)),
+          _children(std::move(senders), this) {}
+
+    When_all_operation(const When_all_operation &) = delete;
+    When_all_operation& operator=(const When_all_operation &) = delete;
+
+    void start() noexcept;
+
+private:
+    template <size_t I>
+    struct Child_receiver {
+        void set_value(auto &&...values) { _op->template set_child_value<I>(std::forward<decltype(values)>(values)...); }
+        void set_error(std::exception_ptr exception) noexcept { _op->set_child_error(std::move(exception)); }
+
+        When_all_operation *_op;
+    };
+
+    template <size_t I>
+    struct Child {
+        using Child_sender = std::tuple_element_t<I, std::tuple<Senders...>>;
+
+        Child(Child_sender &&sender, When_all_operation *op)
+            : _op(std::move(sender).connect(Child_receiver<I>{op})) {}
+
+        Operation_of<Child_sender, Child_receiver<I>> _op;
+    };
+
+    template <typename Indices>
+    struct Children;
+
+    template <size_t ...I>
+    struct Children<std::index_sequence<I...>>: Child<I>... {
+        Children(std::tuple<Senders...> &&senders, When_all_operation *op)
+            : Child<I>(std::get<I>(std::move(senders)), op)... {}
+
+        void start() noexcept { (Child<I>::_op.start(), ...); }
+    };
+
+    template <size_t I>
+    void set_child_value(auto &&...values);
+
+    void set_child_error(std::exception_ptr exception) noexcept;
+
+    // The last one completes the receiver
+    void arrive() noexcept;
+
+    template <size_t ...I>
+    void complete(std::index_sequence<I...>);
+
+    template <size_t I>
+    auto take_value();
+
+    Receiver _receiver;
+    std::tuple<Value_storage<Value_of<Senders>>...> _values;
+    // +1 for start(), children may complete before all of them are started
+    std::atomic<size_t> _remaining {sizeof...(Senders) + 1};
+    std::atomic<bool> _failed {false};
+    std::exception_ptr _error;
+    // Initialized last, it refers to this
+    Children<std::index_sequence_for<Senders...>> _children;
+};
+
+template <typename ...Senders>
+class When_all_sender {
+public:
+    using Value_type = typename When_all_traits<Senders...>::Value_type;
+
+    explicit When_all_sender(Senders ...senders): _senders(std::move(senders)...) {}
+
+    template <typename Receiver>
+    When_all_operation<Receiver, Senders...> connect(Receiver receiver) && {
+        return {std::move(_senders), std::move(receiver)};
+    }
+
+private:
+    std::tuple<Senders...> _senders;
+};
+
+
+
+// Result of sync_wait(), on the caller stack
+template <typename T>
+struct Sync_wait_state {
+    // Spin, then sleep
+    void wait();
+
+    void finish() noexcept;
+
+    // The waiter may return (and destroy this state on its stack) once it sees `done`,
+    // so a sleeper is woken up while the state is `notified`, and `done` is the last write
+    static constexpr uint32_t pending = 0;
+    static constexpr uint32_t done = 1;
+    static constexpr uint32_t waiting = 2;
+    static constexpr uint32_t notified = 3;
+
+    std::atomic<uint32_t> _state {pending};
+    std::variant<std::monostate, Value_storage<T>, std::exception_ptr> _result;
+};
+
+template <typename T>
+struct Sync_wait_receiver {
+    void set_value(auto &&...values) {
+        if constexpr (std::is_void_v<T>) {
+            _state->_result.template emplace<1>();
+        } else {
+            _state->_result.template emplace<1>(std::in_place, std::forward<decltype(values)>(values)...);
+        }
+        _state->finish();
+    }
+
+    void set_error(std::exception_ptr exception) noexcept {
+        _state->_result.template emplace<2>(std::move(exception));
+        _state->finish();
+    }
+
+    Sync_wait_state<T> *_state;
+};
+
+
+
+template <typename Executor, typename Receiver>
+inline void Schedule_operation<Executor, Receiver>::start() noexcept {
+    try {
+        if constexpr (is_embeddable) {
+            _ex.execute_embedded(_node, {&run, this});
+        } else {
+            _ex.execute([this] { run(this); });
+        }
+    } catch(...) {
+        _receiver.set_error(std::current_exception());
+    }
+}
+
+template <typename Executor>
+inline auto Schedule_sender<Executor>::operator co_await() && {
+    if constexpr (requires { _ex.schedule(); }) {
+        // Co_await executors, e.g. Static_thread_pool::Schedule_awaitable
+        return _ex.schedule();
+    } else if constexpr (Embeddable_executor<Executor>) {
+        return Schedule_awaiter<Executor>{std::move(_ex)};
+    } else {
+        return Execute_awaitable<Executor>{std::move(_ex)};
+    }
+}
+
+template <typename Executor>
+inline void Schedule_awaiter<Executor>::await_suspend(std::coroutine_handle<> handle) {
+    _ex.execute_embedded(_node, {
+        [](void *address) { std::coroutine_handle<>::from_address(address).resume(); },
+        handle.address()
+    });
+}
+
+template <typename Receiver, typename ...Senders>
+inline void When_all_operation<Receiver, Senders...>::start() noexcept {
+    _children.start();
+    arrive();
+}
+
+template <typename Receiver, typename ...Senders>
+template <size_t I>
+inline void When_all_operation<Receiver, Senders...>::set_child_value(auto &&...values) {
+    if constexpr (sizeof...(values) > 0) {
+        std::get<I>(_values).emplace(std::forward<decltype(values)>(values)...);
+    }
+    arrive();
+}
+
+template <typename Receiver, typename ...Senders>
+inline void When_all_operation<Receiver, Senders...>::set_child_error(std::exception_ptr exception) noexcept {
+    // The first error wins
+    if(!_failed.exchange(true, std::memory_order_relaxed)) {
+        _error = std::move(exception);
+    }
+    arrive();
+}
+
+template <typename Receiver, typename ...Senders>
+inline void When_all_operation<Receiver, Senders...>::arrive() noexcept {
+    if(_remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    if(_failed.load(std::memory_order_relaxed)) {
+        _receiver.set_error(std::move(_error));
+        return;
+    }
+    try {
+        complete(std::index_sequence_for<Senders...>{});
+    } catch(...) {
+        // Only if a value is failed to move
+        _receiver.set_error(std::current_exception());
+    }
+}
+
+template <typename Receiver, typename ...Senders>
+template <size_t ...I>
+inline void When_all_operation<Receiver, Senders...>::complete(std::index_sequence<I...>) {
+    if constexpr (std::is_void_v<typename When_all_traits<Senders...>::Value_type>) {
+        _receiver.set_value();
+    } else {
+        _receiver.set_value(std::tuple_cat(take_value<I>()...));
+    }
+}
+
+template <typename Receiver, typename ...Senders>
+template <size_t I>
+inline auto When_all_operation<Receiver, Senders...>::take_value() {
+    using T = Value_of<std::tuple_element_t<I, std::tuple<Senders...>>>;
+    if constexpr (std::is_void_v<T>) {
+        return std::tuple<>{};
+    } else {
+        return std::tuple<T>{std::move(*std::get<I>(_values))};
+    }
+}
+
+template <typename T>
+inline void Sync_wait_state<T>::wait() {
+    Backoff backoff {64, 4};
+    for(uint32_t state; (state = _state.load(std::memory_order_acquire)) != done;) {
+        if(backoff.pause()) continue;
+        // Woken up, `done` follows right after the wakeup
+        if(state == notified) {
+            std::this_thread::yield();
+            continue;
+        }
+        if(state == waiting || _state.compare_exchange_strong(state, waiting, std::memory_order_acquire)) {
+            Futex::wait(_state, waiting);
+        }
+    }
+}
+
+template <typename T>
+inline void Sync_wait_state<T>::finish() noexcept {
+    uint32_t state = pending;
+    if(_state.compare_exchange_strong(state, done, std::memory_order_release)) return;
+    // A sleeper, it cannot leave before `done`
+    _state.store(notified, std::memory_order_relaxed);
+    Futex::wake_all(_state);
+    _state.store(done, std::memory_order_release);
+}
+
+} // namespace senders_impl
+} // namespace impl
+} // namespace bsio